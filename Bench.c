@@ -0,0 +1,398 @@
+/*
+ Copyright (c) 2021 mizuyoukanao
+ License: MIT
+ */
+
+/*
+ * Cycle benchmark, built by "make bench" and run under simavr.
+ *
+ * A scripted host feeds OUT packets to process_OUT_report and pulls IN packets with send_IN_report, the same way
+ * adapter_switch.c does. Every call is timed with Timer3 running at F_CPU, so the numbers are exact cycle counts.
+ * Results are printed through the simavr console as "bench <name> <cycles>" lines and checked against
+ * tools/bench_budget.txt by tools/bench_check.py. The budgets there are estimates until they are replaced with
+ * numbers from a simavr run (marked with ~), so a pass only means nothing grew past the estimate.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#include "avr_mcu_section.h"
+#include "Response.h"
+#include "Turbo.h"
+#include "Socd.h"
+#include "Remap.h"
+#include "Mixer.h"
+#include "InputLatch.h"
+
+AVR_MCU(F_CPU, "atmega32u4");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#define REPEAT 8 // Worst of REPEAT runs is reported
+
+static USB_ExtendedReport_t report;
+static USB_ExtendedReport_t *selectedReport = &report;
+static uint8_t packet[JOYSTICK_EPSIZE];
+static uint8_t endpoint[JOYSTICK_EPSIZE];
+static uint16_t overhead = 0;
+
+// Every subcommand in Switch_Subcommand_t, with the arguments a console would send
+typedef struct {
+    uint8_t subcommand;
+    uint8_t args[5];
+} Bench_Subcommand_t;
+
+static const Bench_Subcommand_t subcommands[] PROGMEM = {
+    {SUBCOMMAND_CONTROLLER_STATE_ONLY,        {0}},
+    {SUBCOMMAND_BLUETOOTH_MANUAL_PAIRING,     {0x01}},
+    {SUBCOMMAND_REQUEST_DEVICE_INFO,          {0}},
+    {SUBCOMMAND_SET_INPUT_REPORT_MODE,        {0x30}},
+    {SUBCOMMAND_TRIGGER_BUTTONS_ELAPSED_TIME, {0}},
+    {SUBCOMMAND_GET_PAGE_LIST_STATE,          {0}},
+    {SUBCOMMAND_SET_HCI_STATE,                {0x00}},
+    {SUBCOMMAND_RESET_PAIRING_INFO,           {0}},
+    {SUBCOMMAND_SET_SHIPMENT_LOW_POWER_STATE, {0x00}},
+    {SUBCOMMAND_SPI_FLASH_READ,               {0x00, 0x60, 0x00, 0x00, 0x10}},
+    {SUBCOMMAND_SPI_FLASH_WRITE,              {0x10, 0x80, 0x00, 0x00, 0x02}},
+    {SUBCOMMAND_SPI_SECTOR_ERASE,             {0x00, 0x80, 0x00, 0x00}},
+    {SUBCOMMAND_RESET_NFC_IR_MCU,             {0}},
+    {SUBCOMMAND_SET_NFC_IR_MCU_CONFIG,        {0x21, 0x00}},
+    {SUBCOMMAND_SET_NFC_IR_MCU_STATE,         {0x01}},
+    {SUBCOMMAND_SET_PLAYER_LIGHTS,            {0x01}},
+    {SUBCOMMAND_GET_PLAYER_LIGHTS,            {0}},
+    {SUBCOMMAND_SET_HOME_LIGHTS,              {0x1F, 0xF0}},
+    {SUBCOMMAND_ENABLE_IMU,                   {0x00}},
+    {SUBCOMMAND_SET_IMU_SENSITIVITY,          {0x03, 0x00, 0x00, 0x01}},
+    {SUBCOMMAND_WRITE_IMU_REGISTERS,          {0x10, 0x01, 0x00}},
+    {SUBCOMMAND_READ_IMU_REGISTERS,           {0x10, 0x10}},
+    {SUBCOMMAND_ENABLE_VIBRATION,             {0x01}},
+    {SUBCOMMAND_GET_REGULATED_VOLTAGE,        {0}},
+};
+
+// SPI reads issued during a real handshake: address, size
+static const uint16_t spi_reads[][2] PROGMEM = {
+    {ADDRESS_SERIAL_NUMBER,         0x10},
+    {ADDRESS_FACTORY_CALIBRATION_1, 0x18},
+    {ADDRESS_FACTORY_CALIBRATION_2, 0x19},
+    {ADDRESS_CONTROLLER_COLOR,      0x0D},
+    {ADDRESS_FACTORY_PARAMETERS_1,  0x18},
+    {ADDRESS_FACTORY_PARAMETERS_2,  0x12},
+    {ADDRESS_STICKS_CALIBRATION,    0x18},
+    {ADDRESS_IMU_CALIBRATION,       0x18},
+};
+
+static const uint8_t commands_80[] PROGMEM = {0x01, 0x02, 0x03, 0x05, 0x04};
+
+void bench_write_IN(const uint8_t *data, uint8_t length) {
+    memcpy(endpoint, data, length);
+}
+
+static bool before_send(void) {
+    return true;
+}
+
+// The input state path of adapter_switch.c, so the RX case includes what the interrupt does with a frame
+void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+    if (type == HOSTLINK_INPUT_STATE && length == REPORT_INPUT_BYTES) {
+        clock_now();
+        input_latch_push(payload);
+    }
+}
+
+/*
+ * Output through the simavr console register
+ */
+
+static void print_char(char c) {
+    GPIOR0 = c;
+}
+
+static void print_string_P(const char *s) {
+    char c;
+    while ((c = pgm_read_byte(s++)) != '\0') {
+        print_char(c);
+    }
+}
+
+static void print_hex(uint16_t value, uint8_t digits) {
+    while (digits--) {
+        uint8_t nibble = (value >> (digits * 4)) & 0x0F;
+        print_char(nibble < 10 ? '0' + nibble : 'a' + nibble - 10);
+    }
+}
+
+static void print_decimal(uint32_t value) {
+    char buf[10];
+    uint8_t n = 0;
+    do {
+        buf[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) {
+        print_char(buf[--n]);
+    }
+}
+
+static void print_result(const char *name, uint16_t suffix, uint8_t suffixDigits, uint32_t cycles) {
+    print_string_P(PSTR("bench "));
+    print_string_P(name);
+    if (suffixDigits) {
+        print_char('/');
+        print_hex(suffix, suffixDigits);
+    }
+    print_char(' ');
+    print_decimal(cycles);
+    print_char('\n');
+}
+
+/*
+ * Timer3 at F_CPU. Calls longer than 65535 cycles are reported as 65535 + the overflow flag.
+ */
+
+static inline void cycles_start(void) {
+    TIFR3 = (1 << TOV3);
+    TCNT3 = 0;
+}
+
+static inline uint32_t cycles_stop(void) {
+    uint16_t t = TCNT3;
+    uint32_t cycles = (TIFR3 & (1 << TOV3)) ? 0xFFFFUL + t : t;
+    return cycles > overhead ? cycles - overhead : 0;
+}
+
+static void flush(void) {
+    send_IN_report();
+}
+
+static uint32_t time_OUT(uint8_t length) {
+    uint8_t copy[JOYSTICK_EPSIZE];
+    uint32_t worst = 0;
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        memcpy(copy, packet, sizeof(copy));
+        flush();
+        cycles_start();
+        process_OUT_report(copy, length);
+        uint32_t cycles = cycles_stop();
+        if (cycles > worst) worst = cycles;
+    }
+    flush();
+    return worst;
+}
+
+static uint32_t time_IN(void) {
+    uint32_t worst = 0;
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        cycles_start();
+        send_IN_report();
+        uint32_t cycles = cycles_stop();
+        if (cycles > worst) worst = cycles;
+    }
+    return worst;
+}
+
+static void set_subcommand(uint8_t subcommand, const uint8_t *args) {
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x01;
+    packet[10] = subcommand;
+    memcpy_P(&packet[11], args, 5);
+}
+
+int main(void) {
+    TCCR3A = 0;
+    TCCR3B = (1 << CS30); // F_CPU
+    clock_init();
+    sei();
+
+    cycles_start();
+    overhead = 0;
+    overhead = cycles_stop();
+
+    memset(&report, 0, sizeof(report));
+    setup_response_manager(before_send, &selectedReport);
+    flush();
+
+    // 0x80 commands, 0x04 last since it starts the 0x30 reports
+    for (uint8_t i = 0; i < sizeof(commands_80); i++) {
+        uint8_t command = pgm_read_byte(&commands_80[i]);
+        memset(packet, 0, sizeof(packet));
+        packet[0] = 0x80;
+        packet[1] = command;
+        print_result(PSTR("process_OUT_report/80"), command, 2, time_OUT(2));
+    }
+
+    for (uint8_t i = 0; i < sizeof(subcommands) / sizeof(subcommands[0]); i++) {
+        uint8_t subcommand = pgm_read_byte(&subcommands[i].subcommand);
+        set_subcommand(subcommand, subcommands[i].args);
+        print_result(PSTR("process_OUT_report/sub"), subcommand, 2, time_OUT(sizeof(packet)));
+    }
+
+    for (uint8_t i = 0; i < sizeof(spi_reads) / sizeof(spi_reads[0]); i++) {
+        uint16_t address = pgm_read_word(&spi_reads[i][0]);
+        uint8_t args[5] = {address & 0xFF, address >> 8, 0x00, 0x00, pgm_read_word(&spi_reads[i][1])};
+        memset(packet, 0, sizeof(packet));
+        packet[0] = 0x01;
+        packet[10] = SUBCOMMAND_SPI_FLASH_READ;
+        memcpy(&packet[11], args, sizeof(args));
+        print_result(PSTR("prepare_spi_reply"), address, 4, time_OUT(sizeof(packet)));
+    }
+
+    print_result(PSTR("send_IN_report/standard"), 0, 0, time_IN());
+
+    static const uint8_t imu_on[5] PROGMEM = {0x01};
+    set_subcommand(SUBCOMMAND_ENABLE_IMU, imu_on);
+    time_OUT(sizeof(packet));
+    print_result(PSTR("send_IN_report/extended"), 0, 0, time_IN());
+
+    // The first 0x3F report after the mode change is always sent, so the worst case is a full encode
+    static const uint8_t report_modes[][5] PROGMEM = {{0x31}, {0x3F}, {0x30}};
+    set_subcommand(SUBCOMMAND_SET_INPUT_REPORT_MODE, report_modes[0]);
+    time_OUT(sizeof(packet));
+    print_result(PSTR("send_IN_report/nfc_ir"), 0, 0, time_IN());
+    set_subcommand(SUBCOMMAND_SET_INPUT_REPORT_MODE, report_modes[1]);
+    time_OUT(sizeof(packet));
+    print_result(PSTR("send_IN_report/simple"), 0, 0, time_IN());
+    set_subcommand(SUBCOMMAND_SET_INPUT_REPORT_MODE, report_modes[2]);
+    time_OUT(sizeof(packet));
+
+    // Every button held with turbo, the cost doesn't depend on how many
+    for (uint8_t button = 0; button < REPORT_BUTTON_BYTES * 8; button++) {
+        turbo_set(button, button % TURBO_MAX_PERIOD + 1);
+    }
+    uint8_t buttons[REPORT_BUTTON_BYTES];
+    uint32_t turboWorst = 0;
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        memset(buttons, 0xFF, sizeof(buttons));
+        cycles_start();
+        turbo_apply(buttons);
+        uint32_t cycles = cycles_stop();
+        if (cycles > turboWorst) turboWorst = cycles;
+    }
+    print_result(PSTR("turbo_apply"), 0, 0, turboWorst);
+
+    // Left + right and up + down alternating, so the last input state changes on every call
+    socd_set_mode(SOCD_LAST_INPUT);
+    socd_set_lever(LEVER_LEFT_STICK);
+    USB_StandardReport_t socdReport;
+    uint32_t socdWorst = 0;
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        memset(&socdReport, 0, sizeof(socdReport));
+        REPORT_BUTTONS(&socdReport)[2] = (i & 1) ? 0x0F : 0x06;
+        cycles_start();
+        socd_apply(&socdReport);
+        uint32_t cycles = cycles_stop();
+        if (cycles > socdWorst) socdWorst = cycles;
+    }
+    print_result(PSTR("socd_apply"), 0, 0, socdWorst);
+
+#ifdef ADAPTER_REMAP_LAYERS
+    // Every button moved, the cost doesn't depend on the map
+    remap_init();
+    for (uint8_t button = 0; button < REMAP_BUTTONS; button++) {
+        remap_set(0, button, REMAP_BUTTONS - 1 - button);
+    }
+    remap_task();
+    uint8_t remapButtons[REPORT_BUTTON_BYTES];
+    uint32_t remapWorst = 0;
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        memset(remapButtons, 0x5A + i, sizeof(remapButtons));
+        cycles_start();
+        remap_apply(remapButtons);
+        uint32_t cycles = cycles_stop();
+        if (cycles > remapWorst) remapWorst = cycles;
+    }
+    print_result(PSTR("remap_apply"), 0, 0, remapWorst);
+#endif
+
+#ifdef ADAPTER_MIXER
+    // Every source live with both sticks held and an override window open, so no branch is skipped
+    static const uint8_t held[REPORT_INPUT_BYTES] PROGMEM = {0x01, 0x02, 0x04, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00};
+    uint8_t sourceState[REPORT_INPUT_BYTES];
+    memcpy_P(sourceState, held, sizeof(sourceState));
+    for (uint8_t source = 0; source < MIXER_SOURCES; source++) {
+        mixer_configure(source, source, 60000);
+        mixer_submit(source, sourceState);
+        sourceState[0]++;
+    }
+    USB_StandardReport_t mixerReport;
+    uint32_t mixerWorst = 0;
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        memset(&mixerReport, 0, sizeof(mixerReport));
+        cycles_start();
+        mixer_resolve(&mixerReport);
+        uint32_t cycles = cycles_stop();
+        if (cycles > mixerWorst) mixerWorst = cycles;
+    }
+    print_result(PSTR("mixer_resolve"), 0, 0, mixerWorst);
+#endif
+
+    // UART receive path: the RX interrupt body for every byte of an input state frame. The worst byte is the checksum,
+    // which runs the frame callback. The interrupt entry and exit (about 40 cycles per byte) aren't included.
+    input_latch_set_policy(LATCH_QUEUE);
+    uint8_t frame[HOSTLINK_FRAME_OVERHEAD + REPORT_INPUT_BYTES];
+    uint32_t byteWorst = 0;
+    uint32_t frameWorst = 0;
+    static const uint8_t state[REPORT_INPUT_BYTES] PROGMEM = {0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80};
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        frame[0] = HOSTLINK_SYNC;
+        frame[1] = HOSTLINK_INPUT_STATE;
+        frame[2] = REPORT_INPUT_BYTES;
+        memcpy_P(&frame[3], state, REPORT_INPUT_BYTES);
+        frame[3] = 0x08 << (i & 1); // A and B alternating, every frame is an edge for the latch
+        uint8_t checksum = 0;
+        for (uint8_t n = 1; n < sizeof(frame) - 1; n++) {
+            checksum ^= frame[n];
+        }
+        frame[sizeof(frame) - 1] = checksum;
+
+        uint32_t total = 0;
+        for (uint8_t n = 0; n < sizeof(frame); n++) {
+            cycles_start();
+            hostlink_receive_byte(frame[n]);
+            uint32_t cycles = cycles_stop();
+            total += cycles;
+            if (cycles > byteWorst) byteWorst = cycles;
+        }
+        if (total > frameWorst) frameWorst = total;
+        input_latch_resolve(&report.standardReport); // Empty the queue like a report would
+    }
+    print_result(PSTR("hostlink_receive_byte"), 0, 0, byteWorst);
+    print_result(PSTR("hostlink_receive_frame"), 0, 0, frameWorst);
+
+    // UART path: queue one event frame, then send its bytes
+    while (hostlink_tx_free() < HOSTLINK_TX_BUFFER_SIZE - 1) {
+        hostlink_tx_task(); // Console events queued by the subcommands above
+    }
+    uint8_t value = 0x01;
+    uint32_t worst = 0;
+    for (uint8_t i = 0; i < REPEAT; i++) {
+        cycles_start();
+        hostlink_send_frame(HOSTLINK_EVENT_PLAYER_LIGHTS, &value, 1);
+        uint32_t cycles = cycles_stop();
+        if (cycles > worst) worst = cycles;
+        while (hostlink_tx_free() < HOSTLINK_TX_BUFFER_SIZE - 1) {
+            hostlink_tx_task();
+        }
+    }
+    print_result(PSTR("hostlink_send_frame"), 0, 0, worst);
+
+    worst = 0;
+    hostlink_send_frame(HOSTLINK_EVENT_PLAYER_LIGHTS, &value, 1);
+    while (hostlink_tx_free() < HOSTLINK_TX_BUFFER_SIZE - 1) {
+        while (!(UCSR1A & (1 << UDRE1))); // Time the queue, not the baud rate
+        cycles_start();
+        hostlink_tx_task();
+        uint32_t cycles = cycles_stop();
+        if (cycles > worst) worst = cycles;
+    }
+    print_result(PSTR("hostlink_tx_task"), 0, 0, worst);
+
+    print_string_P(PSTR("bench done\n"));
+
+    // simavr stops on sleep with interrupts disabled
+    cli();
+    sleep_cpu();
+    for (;;);
+}
@@ -0,0 +1,32 @@
+#include "Clock.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+static volatile uint16_t overflows = 0;
+
+ISR(TIMER1_OVF_vect) {
+    overflows++;
+}
+
+void clock_init(void) {
+    TCCR1A = 0;
+    TCCR1B = (1 << CS12); // Normal mode, F_CPU / 256
+    TCNT1 = 0;
+    TIMSK1 |= (1 << TOIE1);
+}
+
+uint32_t clock_now(void) {
+    uint16_t high;
+    uint16_t low;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        high = overflows;
+        low = TCNT1;
+        // Overflow happened after interrupts were disabled and hasn't been counted yet
+        if ((TIFR1 & (1 << TOV1)) && low < 0x8000) {
+            high++;
+        }
+    }
+    return ((uint32_t) high << 16) | low;
+}
@@ -0,0 +1,16 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+/*
+ * Monotonic clock driven by Timer1 running at F_CPU / 256.
+ * One tick is 16 us at 16 MHz, the 32 bit value wraps after ~19 hours, so only compare differences.
+ */
+#define CLOCK_PRESCALER      256UL
+#define CLOCK_US_TO_TICKS(us) ((uint32_t) ((us) * (F_CPU / 1000000UL) / CLOCK_PRESCALER))
+
+void clock_init(void);
+uint32_t clock_now(void);
+
+#endif // CLOCK_H
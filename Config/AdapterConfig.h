@@ -0,0 +1,83 @@
+/*
+ Copyright (c) 2021 mizuyoukanao
+ License: MIT
+ */
+
+/*
+ * Adapter compile time options.
+ *
+ * Optional features are enabled by defining the tokens below (or by passing them through CC_FLAGS in the makefile).
+ * Commented out tokens are disabled.
+ */
+#ifndef ADAPTER_CONFIG_H
+#define ADAPTER_CONFIG_H
+
+// UART to the PC
+#define ADAPTER_UART_BAUD         9600
+#define ADAPTER_UART_DOUBLE_SPEED false
+
+// Release all inputs if no frame arrives from the PC for this long. The PC then has to repeat the current state at
+// least this often while holding inputs (tools/hostlink does), so PC tools that only send changes need it off.
+// Also releases mixer sources that stop being fed (ADAPTER_MIXER).
+//#define ADAPTER_STREAM_TIMEOUT_MS 500
+// Valid frames needed before the input stream is used again after a stall
+#define ADAPTER_STREAM_RESYNC_FRAMES 2
+
+// How button presses shorter than a USB poll are reported (Latch_Policy_t, see InputLatch.h)
+#define ADAPTER_LATCH_POLICY LATCH_HOLD_PRESSES
+
+// What happens when opposite directions are held (Socd_Mode_t), and where the lever goes (Lever_Mode_t), see Socd.h
+#define ADAPTER_SOCD_MODE  SOCD_NEUTRAL
+#define ADAPTER_LEVER_MODE LEVER_DPAD
+
+// Button remapping with this many layers, kept in EEPROM (see Remap.h). Holding the combo (button bytes of the
+// report, here - and +) for ADAPTER_REMAP_HOLD_MS switches to the next layer.
+#define ADAPTER_REMAP_LAYERS  2
+#define ADAPTER_REMAP_COMBO   {0x00, 0x03, 0x00}
+#define ADAPTER_REMAP_HOLD_MS 1000
+
+// Count how many times the console sent each subcommand (costs 2 bytes of RAM per subcommand id), read them with
+// tools/stats_tool.py
+#define ADAPTER_SUBCOMMAND_STATS
+
+// Report player lights, HOME light, input report mode, IMU and vibration changes to the PC (see HostLink.h)
+#define ADAPTER_CONSOLE_EVENTS
+
+// Double-bank the IN endpoint and commit a 0x30 report as soon as new input arrives, instead of whenever the bank
+// frees up. Unchanged reports are committed ADAPTER_IN_STAGE_MARGIN_US before the next expected poll, so they carry
+// the freshest state. ADAPTER_IN_POLL_MS must match the IN endpoint interval in Descriptors.c, it also sets the rate
+// of 0x3F reports (see Response.c).
+#define ADAPTER_IN_PIPELINE
+#define ADAPTER_IN_POLL_MS         8
+#define ADAPTER_IN_STAGE_MARGIN_US 1000
+
+// Emulate two Pro Controllers on one USB device, as a second HID interface on endpoints 3 and 4. Both are fed from
+// the same UART: HOSTLINK_INPUT_STATE frames with HOSTLINK_PLAYER_2 in their type are the second controller's, and
+// they are used as sent (latching, SOCD, turbo, remapping, mixing, TAS and recording only apply to the first one).
+// Two streams at 125 frames per second need a UART of at least 38400 baud.
+//#define ADAPTER_DUAL
+
+// Lock-step TAS mode with a queue of N frames (9 bytes of RAM each), see Tas.h. At 125 reports per second the
+// frames and acks need a UART of at least 38400 baud.
+//#define ADAPTER_TAS_QUEUE_SIZE 32
+
+// Send 0x30 reports every N ms even if the host polls faster, with drift statistics
+//#define ADAPTER_REPORT_PACING_MS 8
+
+// Stream every OUT and IN packet to the PC (see Trace.h), needs a fast UART such as 1000000 baud
+//#define ADAPTER_TRACE
+
+// Binary event log sent to the PC when the UART is idle (see Log.h), decode with tools/log_decode.py.
+// 1 = protocol events, 2 = also every IN and OUT report.
+//#define ADAPTER_LOG 1
+
+// Merge other input sources (wired controls, macros) with the PC stream, see Mixer.h. Sticks closer to center than
+// the deadzone (12 bit units) don't take over from a lower priority source.
+//#define ADAPTER_MIXER
+#define ADAPTER_MIXER_DEADZONE 256
+
+// Record the reports' inputs to N bytes of EEPROM for playback and export, see Record.h. The 32u4 has 1024 bytes,
+// shared with ADAPTER_REMAP_LAYERS (1 + 24 per layer) and 2 bytes for the stream length.
+//#define ADAPTER_RECORD_EEPROM_SIZE 960
+
+#endif // ADAPTER_CONFIG_H
@@ -124,7 +124,7 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
                 .Header                 = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
 
                 .TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
-                .TotalInterfaces        = 1,
+                .TotalInterfaces        = JOYSTICK_COUNT,
 
                 .ConfigurationNumber    = 1,
                 .ConfigurationStrIndex  = NO_DESCRIPTOR,
@@ -176,6 +176,52 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
                 .EndpointSize           = JOYSTICK_EPSIZE,
                 .PollingIntervalMS      = 0x08
         },
+#ifdef ADAPTER_DUAL
+
+        // Same as the first interface, on the next two endpoints
+        .HID2_Interface = {
+                .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+                .InterfaceNumber        = INTERFACE_ID_Joystick2,
+                .AlternateSetting       = 0x00,
+
+                .TotalEndpoints         = 2,
+
+                .Class                  = HID_CSCP_HIDClass,
+                .SubClass               = HID_CSCP_NonBootSubclass,
+                .Protocol               = HID_CSCP_NonBootProtocol,
+
+                .InterfaceStrIndex      = NO_DESCRIPTOR
+        },
+
+        .HID2_JoystickHID = {
+                .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
+
+                .HIDSpec                = VERSION_BCD(1,1,1),
+                .CountryCode            = 0x00,
+                .TotalReportDescriptors = 1,
+                .HIDReportType          = HID_DTYPE_Report,
+                .HIDReportLength        = sizeof(JoystickReport)
+        },
+
+        .HID2_ReportINEndpoint = {
+                .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+                .EndpointAddress        = JOYSTICK_PLAYER_IN_EPADDR(1),
+                .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+                .EndpointSize           = JOYSTICK_EPSIZE,
+                .PollingIntervalMS      = 0x08
+        },
+
+        .HID2_ReportOUTEndpoint = {
+                .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+                .EndpointAddress        = JOYSTICK_PLAYER_OUT_EPADDR(1),
+                .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+                .EndpointSize           = JOYSTICK_EPSIZE,
+                .PollingIntervalMS      = 0x08
+        },
+#endif
 };
 
 // Language Descriptor Structure
@@ -247,7 +293,13 @@ uint16_t CALLBACK_USB_GetDescriptor(
 
             break;
         case DTYPE_HID:
+            // wIndex is the interface number
             Address = &ConfigurationDescriptor.HID_JoystickHID;
+#ifdef ADAPTER_DUAL
+            if (wIndex == INTERFACE_ID_Joystick2) {
+                Address = &ConfigurationDescriptor.HID2_JoystickHID;
+            }
+#endif
             Size    = sizeof(USB_HID_Descriptor_HID_t);
             break;
         case DTYPE_Report:
@@ -15,11 +15,19 @@ typedef struct {
     USB_HID_Descriptor_HID_t              HID_JoystickHID;
     USB_Descriptor_Endpoint_t             HID_ReportOUTEndpoint;
     USB_Descriptor_Endpoint_t             HID_ReportINEndpoint;
+#ifdef ADAPTER_DUAL
+    // Second joystick HID Interface
+    USB_Descriptor_Interface_t            HID2_Interface;
+    USB_HID_Descriptor_HID_t              HID2_JoystickHID;
+    USB_Descriptor_Endpoint_t             HID2_ReportOUTEndpoint;
+    USB_Descriptor_Endpoint_t             HID2_ReportINEndpoint;
+#endif
 } USB_Descriptor_Configuration_t;
 
 // Device Interface Descriptor IDs
 enum InterfaceDescriptors_t {
-    INTERFACE_ID_Joystick = 0, /**< Joystick interface descriptor ID */
+    INTERFACE_ID_Joystick  = 0, /**< Joystick interface descriptor ID */
+    INTERFACE_ID_Joystick2 = 1, /**< Second joystick interface descriptor ID (ADAPTER_DUAL) */
 };
 
 // Device String Descriptor IDs
@@ -34,6 +42,14 @@ enum StringDescriptors_t {
 // Endpoint Addresses
 #define JOYSTICK_IN_EPADDR  (ENDPOINT_DIR_IN  | 1)
 #define JOYSTICK_OUT_EPADDR (ENDPOINT_DIR_OUT | 2)
+// Emulated controllers, one HID interface each. The second one (ADAPTER_DUAL) uses endpoints 3 and 4.
+#ifdef ADAPTER_DUAL
+#define JOYSTICK_COUNT      2
+#else
+#define JOYSTICK_COUNT      1
+#endif
+#define JOYSTICK_PLAYER_IN_EPADDR(player)  (JOYSTICK_IN_EPADDR + 2 * (player))
+#define JOYSTICK_PLAYER_OUT_EPADDR(player) (JOYSTICK_OUT_EPADDR + 2 * (player))
 // HID Endpoint Size
 // The Switch -needs- this to be 64.
 #define JOYSTICK_EPSIZE           64
@@ -3,6 +3,14 @@
 
 #include "datatypes.h"
 #include <string.h>
+#include <avr/pgmspace.h>
+
+// One contiguous extent of the emulated flash, see SPIImage.h
+typedef struct {
+    uint16_t address;
+    uint8_t length;
+    uint16_t offset; // In spi_image_data
+} SPI_Region_t;
 
 void spi_read(SPI_Address_t address, size_t size, uint8_t buf[]);
 
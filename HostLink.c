@@ -0,0 +1,120 @@
+#include "HostLink.h"
+
+#include <LUFA/Drivers/Peripheral/Serial.h>
+
+// Only written from the main loop, so no locking is needed
+static uint8_t txBuffer[HOSTLINK_TX_BUFFER_SIZE];
+static uint8_t txHead = 0;
+static uint8_t txTail = 0;
+
+// Only touched from the RX interrupt
+typedef enum {
+    RX_SYNC,
+    RX_TYPE,
+    RX_LENGTH,
+    RX_PAYLOAD,
+    RX_CHECKSUM,
+} RX_State_t;
+
+static RX_State_t rxState = RX_SYNC;
+static uint8_t rxType;
+static uint8_t rxLength;
+static uint8_t rxCount;
+static uint8_t rxChecksum;
+static uint8_t rxPayload[HOSTLINK_MAX_PAYLOAD];
+static volatile uint16_t rxErrors = 0;
+
+#if HOSTLINK_TX_BUFFER_SIZE > 256 || (HOSTLINK_TX_BUFFER_SIZE & (HOSTLINK_TX_BUFFER_SIZE - 1))
+#error HOSTLINK_TX_BUFFER_SIZE must be a power of 2, 256 at most
+#endif
+
+static void tx_push(uint8_t b) {
+    txBuffer[txHead] = b;
+    txHead = (txHead + 1) & (HOSTLINK_TX_BUFFER_SIZE - 1);
+}
+
+uint8_t hostlink_tx_free(void) {
+    return (HOSTLINK_TX_BUFFER_SIZE - 1) - ((uint8_t) (txHead - txTail) & (HOSTLINK_TX_BUFFER_SIZE - 1));
+}
+
+/*
+ * Queue a frame. Returns false (and queues nothing) if it doesn't fit, the caller decides whether to retry later.
+ */
+bool hostlink_send_frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+    if (hostlink_tx_free() < length + HOSTLINK_FRAME_OVERHEAD) {
+        return false;
+    }
+    uint8_t checksum = type ^ length;
+    tx_push(HOSTLINK_SYNC);
+    tx_push(type);
+    tx_push(length);
+    for (uint8_t i = 0; i < length; i++) {
+        tx_push(payload[i]);
+        checksum ^= payload[i];
+    }
+    tx_push(checksum);
+    return true;
+}
+
+/*
+ * Send at most one byte, called once per main loop iteration.
+ */
+void hostlink_tx_task(void) {
+    if (txHead != txTail && Serial_IsSendReady()) {
+        Serial_SendByte(txBuffer[txTail]);
+        txTail = (txTail + 1) & (HOSTLINK_TX_BUFFER_SIZE - 1);
+    }
+}
+
+/*
+ * Feed one received byte to the frame parser. On a bad length or checksum the parser hunts for the next sync byte.
+ */
+void hostlink_receive_byte(uint8_t b) {
+    switch (rxState) {
+        case RX_SYNC: {
+            if (b == HOSTLINK_SYNC) {
+                rxState = RX_TYPE;
+            }
+            break;
+        }
+        case RX_TYPE: {
+            rxType = b;
+            rxChecksum = b;
+            rxState = RX_LENGTH;
+            break;
+        }
+        case RX_LENGTH: {
+            if (b > HOSTLINK_MAX_PAYLOAD) {
+                rxErrors++;
+                rxState = RX_SYNC;
+                break;
+            }
+            rxLength = b;
+            rxChecksum ^= b;
+            rxCount = 0;
+            rxState = (b == 0) ? RX_CHECKSUM : RX_PAYLOAD;
+            break;
+        }
+        case RX_PAYLOAD: {
+            rxPayload[rxCount++] = b;
+            rxChecksum ^= b;
+            if (rxCount == rxLength) {
+                rxState = RX_CHECKSUM;
+            }
+            break;
+        }
+        case RX_CHECKSUM: {
+            rxState = RX_SYNC;
+            if (b == rxChecksum) {
+                CALLBACK_HostLink_Frame(rxType, rxPayload, rxLength);
+            } else {
+                rxErrors++;
+            }
+            break;
+        }
+    }
+}
+
+uint16_t hostlink_rx_errors(void) {
+    return rxErrors;
+}
@@ -0,0 +1,78 @@
+#ifndef HOST_LINK_H
+#define HOST_LINK_H
+
+#include "datatypes.h"
+
+/*
+ * Framed binary protocol spoken with the PC over the UART.
+ *
+ * Every frame is: HOSTLINK_SYNC, type, payload length, payload, XOR of type, length and payload.
+ * Frames are queued without blocking and sent from the main loop, so the USB reply path never waits on the UART.
+ * Received frames are parsed byte by byte from the RX interrupt and handed to CALLBACK_HostLink_Frame.
+ */
+#define HOSTLINK_SYNC           0xA5
+#define HOSTLINK_FRAME_OVERHEAD 4
+#define HOSTLINK_MAX_PAYLOAD    16 // Longest frame accepted from the PC
+#ifdef ADAPTER_TRACE
+#define HOSTLINK_TX_BUFFER_SIZE 256 // Must be a power of 2, 256 at most
+#else
+#define HOSTLINK_TX_BUFFER_SIZE 64
+#endif
+
+// Frame types, 0x01-0x0F are sent by the PC, the rest by the adapter
+typedef enum {
+    HOSTLINK_INPUT_STATE         = 0x01, // Bytes 1-9 of USB_StandardReport_t: 3 button bytes, 6 analog bytes
+    HOSTLINK_CONFIG              = 0x02, // Config key (HostLink_Config_t), value
+    HOSTLINK_TAS_FRAME           = 0x03, // Same payload as HOSTLINK_INPUT_STATE, queued (see Tas.h)
+    HOSTLINK_TURBO               = 0x04, // Button bit index, period in reports (0 = off), see Turbo.h
+    HOSTLINK_REMAP               = 0x05, // Layer, source button bit, destination button bit (0xFF = none), see Remap.h
+    HOSTLINK_SOURCE_STATE        = 0x06, // Mixer source (Mixer_Source_t), then the HOSTLINK_INPUT_STATE payload
+    HOSTLINK_MIXER               = 0x07, // Mixer source, priority, override window in ms (16 bit LE), see Mixer.h
+    HOSTLINK_RECORD_LOAD         = 0x08, // Recording stream bytes to store, see Record.h
+    HOSTLINK_STATS_REQUEST       = 0x09, // Stats id (HostLink_Stats_t), argument; answered with HOSTLINK_STATS
+    HOSTLINK_EVENT_PLAYER_LIGHTS = 0x10,
+    HOSTLINK_EVENT_HOME_LIGHT    = 0x11,
+    HOSTLINK_EVENT_REPORT_MODE   = 0x12,
+    HOSTLINK_EVENT_IMU           = 0x13,
+    HOSTLINK_EVENT_VIBRATION     = 0x14,
+    HOSTLINK_TAS_ACK             = 0x18, // Report counter, queue depth, flags (see Tas.h)
+    HOSTLINK_TRACE               = 0x20, // See Trace.h
+    HOSTLINK_LOG                 = 0x21, // 1 or 2 records of LOG_RECORD_SIZE bytes, see Log.h
+    HOSTLINK_RECORD              = 0x22, // RECORD_FRAME_* kind, then recording stream bytes (see Record.h)
+    HOSTLINK_STATS               = 0x23, // Stats id, argument, then the stats (none if the build doesn't have them)
+} HostLink_Frame_t;
+
+// HOSTLINK_STATS_REQUEST ids. Counters are sent little-endian, structs as laid out on the AVR (no padding).
+typedef enum {
+    HOSTLINK_STATS_SUBCOMMANDS = 0x01, // Argument: first subcommand id. Hit counts of it and the next 7, uint16_t each
+    HOSTLINK_STATS_PACING      = 0x02, // Argument: controller (0 unless ADAPTER_DUAL). Pacing_Stats_t
+    HOSTLINK_STATS_LATCH       = 0x03, // Latch_Stats_t (InputLatch.h)
+    HOSTLINK_STATS_STREAM      = 0x04, // Stream_Stats_t (datatypes.h)
+    HOSTLINK_STATS_IN_LATENCY  = 0x05, // Argument: controller. In_Latency_Stats_t (datatypes.h)
+    HOSTLINK_STATS_INTERFACE   = 0x06, // Argument: controller. Interface_Stats_t (datatypes.h)
+} HostLink_Stats_t;
+
+// With ADAPTER_DUAL, frames about the second controller have this bit set in their type, in both directions.
+// Only HOSTLINK_INPUT_STATE and the console events are tagged, everything else is about the first controller.
+#define HOSTLINK_PLAYER_2 0x40
+
+// HOSTLINK_CONFIG keys
+typedef enum {
+    HOSTLINK_CONFIG_LATCH_POLICY = 0x01, // Latch_Policy_t, see InputLatch.h
+    HOSTLINK_CONFIG_TAS_MODE     = 0x02, // 1 = enter lock-step TAS mode, 0 = leave it (see Tas.h)
+    HOSTLINK_CONFIG_SOCD_MODE    = 0x03, // Socd_Mode_t, see Socd.h
+    HOSTLINK_CONFIG_LEVER_MODE   = 0x04, // Lever_Mode_t, see Socd.h
+    HOSTLINK_CONFIG_REMAP_LAYER  = 0x05, // Active remap layer, see Remap.h
+    HOSTLINK_CONFIG_RECORD_MODE  = 0x06, // Record_Mode_t, see Record.h
+} HostLink_Config_t;
+
+// Implemented by the application, called from the RX interrupt for every valid frame
+void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length);
+
+void hostlink_receive_byte(uint8_t b);
+uint16_t hostlink_rx_errors(void);
+bool hostlink_send_frame(uint8_t type, const uint8_t *payload, uint8_t length);
+uint8_t hostlink_tx_free(void);
+void hostlink_tx_task(void);
+
+#endif // HOST_LINK_H
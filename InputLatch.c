@@ -0,0 +1,107 @@
+#include "InputLatch.h"
+#include "Response.h"
+
+typedef struct {
+    uint8_t buttons[REPORT_BUTTON_BYTES];
+    uint16_t stamp; // Low 16 bits of clock_now() when the edge arrived
+} Latch_Event_t;
+
+// Written from the RX interrupt, read with it disabled
+static Latch_Policy_t policy = ADAPTER_LATCH_POLICY;
+static const uint8_t neutral[REPORT_INPUT_BYTES] PROGMEM = {0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80};
+static uint8_t current[REPORT_INPUT_BYTES] = {0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80}; // Centered sticks
+static uint8_t latched[REPORT_BUTTON_BYTES]; // OR of every state since the previous report
+static Latch_Event_t queue[LATCH_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueCount = 0;
+static Latch_Stats_t stats;
+
+static void note_latency(uint16_t stamp) {
+    uint16_t latency = (uint16_t) clock_now() - stamp;
+    if (latency > stats.latency_max) {
+        stats.latency_max = latency;
+    }
+}
+
+/*
+ * Called from the RX interrupt with a HOSTLINK_INPUT_STATE payload.
+ * Returns true if any button or stick changed.
+ */
+bool input_latch_push(const uint8_t *state) {
+    bool changed = memcmp(current, state, REPORT_INPUT_BYTES) != 0;
+    if (memcmp(current, state, REPORT_BUTTON_BYTES) != 0) {
+        if (queueCount == LATCH_QUEUE_SIZE) {
+            // Merge into the newest transition, the oldest ones are already waiting to be reported
+            queueCount--;
+            stats.queue_full++;
+        }
+        Latch_Event_t *event = &queue[(queueHead + queueCount) % LATCH_QUEUE_SIZE];
+        memcpy(event->buttons, state, REPORT_BUTTON_BYTES);
+        event->stamp = clock_now();
+        queueCount++;
+
+        for (uint8_t i = 0; i < REPORT_BUTTON_BYTES; i++) {
+            latched[i] |= state[i];
+        }
+    }
+    memcpy(current, state, REPORT_INPUT_BYTES);
+    return changed;
+}
+
+/*
+ * Write the buttons and sticks for the next 0x30 report, called once per report.
+ */
+void input_latch_resolve(USB_StandardReport_t *standardReport) {
+    uint8_t *buttons = REPORT_BUTTONS(standardReport);
+
+    disable_rx_isr();
+    if (policy == LATCH_QUEUE && queueCount > 0) {
+        Latch_Event_t *event = &queue[queueHead];
+        memcpy(buttons, event->buttons, REPORT_BUTTON_BYTES);
+        note_latency(event->stamp);
+        queueHead = (queueHead + 1) % LATCH_QUEUE_SIZE;
+        queueCount--;
+    } else {
+        if (queueCount > 0) {
+            note_latency(queue[queueHead].stamp);
+        }
+        if (policy == LATCH_HOLD_PRESSES) {
+            uint8_t released = 0;
+            for (uint8_t i = 0; i < REPORT_BUTTON_BYTES; i++) {
+                released |= latched[i] & ~current[i];
+                buttons[i] = latched[i];
+            }
+            if (released) {
+                stats.taps_saved++;
+            }
+        } else {
+            memcpy(buttons, current, REPORT_BUTTON_BYTES);
+        }
+        queueCount = 0;
+    }
+    memcpy(latched, current, REPORT_BUTTON_BYTES);
+    memcpy(standardReport->analog, &current[REPORT_BUTTON_BYTES], sizeof(standardReport->analog));
+    enable_rx_isr();
+}
+
+/*
+ * Forget the input state and pending transitions, used when the input stream stalls.
+ */
+void input_latch_reset(void) {
+    disable_rx_isr();
+    memcpy_P(current, neutral, REPORT_INPUT_BYTES);
+    memset(latched, 0, REPORT_BUTTON_BYTES);
+    queueCount = 0;
+    enable_rx_isr();
+}
+
+void input_latch_set_policy(Latch_Policy_t newPolicy) {
+    disable_rx_isr();
+    policy = newPolicy;
+    queueCount = 0;
+    enable_rx_isr();
+}
+
+const Latch_Stats_t *get_latch_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,39 @@
+#ifndef INPUT_LATCH_H
+#define INPUT_LATCH_H
+
+#include "datatypes.h"
+
+/*
+ * Sits between the UART input stream and the 0x30 report.
+ *
+ * The console polls every 8 ms, so a press and release that both arrive between two polls would never be seen if
+ * the report only copied the current state. Button edges are recorded as they arrive and resolved into the report
+ * according to the policy:
+ *   LATCH_LATEST       the state at poll time, short taps can be lost
+ *   LATCH_HOLD_PRESSES every button that was down at any point since the previous report is reported pressed
+ *   LATCH_QUEUE        each report shows the next queued state, so every transition is seen in order.
+ *                      Latency grows by one poll per queued transition, up to LATCH_QUEUE_SIZE.
+ * Analog values always use the latest state.
+ */
+typedef enum {
+    LATCH_LATEST       = 0,
+    LATCH_HOLD_PRESSES = 1,
+    LATCH_QUEUE        = 2,
+} Latch_Policy_t;
+
+#define LATCH_QUEUE_SIZE 8
+
+// In clock ticks
+typedef struct {
+    uint16_t taps_saved;    // Reports that showed a press which had already been released
+    uint16_t queue_full;    // Transitions merged because the queue was full
+    uint16_t latency_max;   // Longest time from a button edge to the report showing it
+} Latch_Stats_t;
+
+bool input_latch_push(const uint8_t *state);
+void input_latch_resolve(USB_StandardReport_t *standardReport);
+void input_latch_reset(void);
+void input_latch_set_policy(Latch_Policy_t policy);
+const Latch_Stats_t *get_latch_stats(void);
+
+#endif // INPUT_LATCH_H
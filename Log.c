@@ -0,0 +1,90 @@
+#include "Log.h"
+#include "Response.h"
+#include "HostLink.h"
+#include "Clock.h"
+
+#include <string.h>
+#include <util/atomic.h>
+
+#ifdef ADAPTER_LOG
+
+#if LOG_RECORDS & (LOG_RECORDS - 1)
+#error LOG_RECORDS must be a power of 2
+#endif
+
+typedef struct {
+    uint8_t id;
+    uint8_t stamp[3]; // Clock ticks, little-endian, wraps every 268 s
+    uint8_t args[LOG_ARGS];
+} Log_Record_t;
+
+static Log_Record_t ring[LOG_RECORDS];
+static volatile uint8_t head = 0;  // Written by log_event, possibly from an interrupt
+static uint8_t tail = 0;           // Written by log_task
+static volatile uint16_t dropped = 0;
+static uint16_t droppedReported = 0;
+
+// Called with interrupts disabled
+static bool store(uint8_t id, uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    if ((uint8_t) (head - tail) >= LOG_RECORDS) {
+        return false;
+    }
+    Log_Record_t *record = &ring[head & (LOG_RECORDS - 1)];
+    uint32_t now = clock_now();
+    record->id = id;
+    record->stamp[0] = now;
+    record->stamp[1] = now >> 8;
+    record->stamp[2] = now >> 16;
+    record->args[0] = a;
+    record->args[1] = b;
+    record->args[2] = c;
+    record->args[3] = d;
+    head++;
+    return true;
+}
+
+/*
+ * Store one record. Safe to call from interrupts.
+ */
+void log_event(uint8_t id, uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!store(id, a, b, c, d)) {
+            dropped++;
+        }
+    }
+}
+
+/*
+ * Send one HOSTLINK_LOG frame if the UART queue is empty and no reply to the console is waiting.
+ */
+void log_task(void) {
+    if (hostlink_tx_free() != HOSTLINK_TX_BUFFER_SIZE - 1 || reply_pending()) {
+        return;
+    }
+
+    // Report drops as soon as there is room, after the records that were kept
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint16_t count = dropped - droppedReported;
+        if (count != 0 && store(LOG_DROPPED, count > 0xFF ? 0xFF : count, 0, 0, 0)) {
+            droppedReported += count > 0xFF ? 0xFF : count;
+        }
+    }
+
+    uint8_t pending = head - tail;
+    if (pending == 0) return;
+    if (pending > 2) pending = 2; // Frames stay short so they never hold up console events for long
+
+    uint8_t payload[2 * LOG_RECORD_SIZE];
+    for (uint8_t i = 0; i < pending; i++) {
+        memcpy(&payload[i * LOG_RECORD_SIZE], &ring[(tail + i) & (LOG_RECORDS - 1)], LOG_RECORD_SIZE);
+    }
+    if (hostlink_send_frame(HOSTLINK_LOG, payload, pending * LOG_RECORD_SIZE)) {
+        tail += pending;
+    }
+}
+
+uint16_t log_dropped_count(void) {
+    return dropped;
+}
+
+#endif
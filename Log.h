@@ -0,0 +1,60 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "datatypes.h"
+
+/*
+ * Binary event log, compiled in with ADAPTER_LOG (1 = protocol events, 2 = also every IN report).
+ *
+ * LOG(id, args...) stores a fixed 8 byte record (id, 24 bit clock timestamp, up to 4 argument bytes) in a RAM ring
+ * and returns, so it can be used on the USB path and in interrupts. log_task() sends the records to the PC as
+ * HOSTLINK_LOG frames, only while nothing else is waiting to go out. Records that don't fit in the ring are
+ * counted and reported with a LOG_DROPPED record.
+ *
+ * tools/log_decode.py turns a UART capture back into messages, using the comment after each id below as the
+ * message: {0}-{3} are the argument bytes, {w0} and {w2} the 16 bit little-endian words at bytes 0 and 2, with
+ * Python format specs such as {0:02x}.
+ */
+typedef enum {
+    LOG_DROPPED          = 0x00, // {0} records dropped, ring full
+    LOG_RESPONSE_8001    = 0x01, // 80 01: MAC address
+    LOG_RESPONSE_8002    = 0x02, // 80 {0:02x}: handshake
+    LOG_RESPONSE_8004    = 0x03, // 80 04: 0x30 reports started
+    LOG_RESPONSE_8005    = 0x04, // 80 05: 0x30 reports stopped
+    LOG_RESPONSE_80      = 0x05, // 80 {0:02x}: unknown command
+    LOG_SUBCOMMAND       = 0x06, // subcommand {0:02x}: unknown
+    LOG_DEVICE_INFO      = 0x07, // subcommand 02: device info
+    LOG_SPI_READ         = 0x08, // subcommand 10: SPI read 0x{1:02x}{0:02x}, {2} bytes
+    LOG_ENABLE_IMU       = 0x09, // subcommand 40: IMU {0}
+    LOG_OUT_REPORT       = 0x0A, // OUT {0:02x}, {1} bytes, subcommand {2:02x}
+    LOG_IN_REPORT        = 0x0B, // IN {0:02x}, IMU {1}
+    LOG_USB_CONNECT      = 0x0C, // USB: VBUS on
+    LOG_USB_DISCONNECT   = 0x0D, // USB: VBUS off
+    LOG_USB_RESET        = 0x0E, // USB: bus reset
+    LOG_USB_SUSPEND      = 0x0F, // USB: suspended
+    LOG_USB_WAKEUP       = 0x10, // USB: resumed
+    LOG_REMOTE_WAKEUP    = 0x11, // USB: remote wakeup sent
+    LOG_FIRST_REPORT     = 0x12, // first 0x30 report: {w0} ms after VBUS, {w2} ms after reset or resume
+} Log_Event_t;
+
+#define LOG_RECORD_SIZE 8
+#define LOG_ARGS        4
+#define LOG_RECORDS     16 // Must be a power of 2
+
+#ifdef ADAPTER_LOG
+#define LOG(...) LOG_EVENT(__VA_ARGS__, 0, 0, 0, 0)
+#define LOG_EVENT(id, a, b, c, d, ...) log_event(id, a, b, c, d)
+#else
+#define LOG(...)
+#endif
+#if defined(ADAPTER_LOG) && ADAPTER_LOG >= 2
+#define LOG_REPORT(...) LOG(__VA_ARGS__)
+#else
+#define LOG_REPORT(...)
+#endif
+
+void log_event(uint8_t id, uint8_t a, uint8_t b, uint8_t c, uint8_t d);
+void log_task(void);
+uint16_t log_dropped_count(void);
+
+#endif // LOG_H
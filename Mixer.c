@@ -0,0 +1,133 @@
+#include "Mixer.h"
+#include "Response.h"
+
+#ifdef ADAPTER_MIXER
+
+#define CENTER            0x800
+#ifdef ADAPTER_STREAM_TIMEOUT_MS
+#define SOURCE_TIMEOUT_TICKS CLOCK_US_TO_TICKS(ADAPTER_STREAM_TIMEOUT_MS * 1000UL)
+#else
+#define SOURCE_TIMEOUT_TICKS 0 // Never
+#endif
+
+// Written from the RX interrupt (HostLink frames), read with it disabled
+static uint8_t inputs[MIXER_SOURCES][REPORT_INPUT_BYTES];
+static uint32_t lastSubmit[MIXER_SOURCES];
+static uint32_t overrideEnd[MIXER_SOURCES];
+static uint8_t active = 1 << MIXER_SOURCE_HOST; // One bit per source
+static uint8_t priority[MIXER_SOURCES] = {
+    [MIXER_SOURCE_HOST]  = 1,
+    [MIXER_SOURCE_LOCAL] = 2,
+    [MIXER_SOURCE_MACRO] = 0,
+};
+static uint32_t overrideTicks[MIXER_SOURCES];
+
+static void open_window(uint8_t source, uint32_t now) {
+    if (overrideTicks[source] != 0) {
+        overrideEnd[source] = now + overrideTicks[source];
+    }
+}
+
+/*
+ * New state for a fed source. With ADAPTER_STREAM_TIMEOUT_MS, must be called at least that often while the source
+ * is in use.
+ * Called from the RX interrupt for HOSTLINK_SOURCE_STATE frames, or from the main loop with the interrupt disabled.
+ * Returns true if the source's state changed.
+ */
+bool mixer_submit(uint8_t source, const uint8_t *state) {
+    if (source == MIXER_SOURCE_HOST || source >= MIXER_SOURCES) {
+        return false;
+    }
+    uint32_t now = clock_now();
+    bool changed = memcmp(inputs[source], state, REPORT_INPUT_BYTES) != 0 || !(active & (1 << source));
+    if (changed) {
+        memcpy(inputs[source], state, REPORT_INPUT_BYTES);
+        open_window(source, now);
+    }
+    lastSubmit[source] = now;
+    active |= 1 << source;
+    return changed;
+}
+
+/*
+ * The PC stream changed, from the RX interrupt. Its state itself is taken from the report in mixer_resolve().
+ */
+void mixer_host_changed(void) {
+    open_window(MIXER_SOURCE_HOST, clock_now());
+}
+
+void mixer_configure(uint8_t source, uint8_t newPriority, uint16_t override_ms) {
+    if (source >= MIXER_SOURCES) {
+        return;
+    }
+    disable_rx_isr();
+    priority[source] = newPriority;
+    overrideTicks[source] = override_ms * CLOCK_US_TO_TICKS(1000);
+    overrideEnd[source] = clock_now();
+    enable_rx_isr();
+}
+
+static bool stick_engaged(const uint8_t *analog) {
+    int16_t x = analog[0] | ((analog[1] & 0x0F) << 8);
+    int16_t y = (analog[1] >> 4) | (analog[2] << 4);
+    return x - CENTER > ADAPTER_MIXER_DEADZONE || CENTER - x > ADAPTER_MIXER_DEADZONE ||
+           y - CENTER > ADAPTER_MIXER_DEADZONE || CENTER - y > ADAPTER_MIXER_DEADZONE;
+}
+
+/*
+ * Merge all sources into the report, which holds the PC stream on entry. Called once per 0x30 report.
+ */
+void mixer_resolve(USB_StandardReport_t *standardReport) {
+    uint8_t *report = REPORT_BUTTONS(standardReport); // Buttons, then the analog bytes
+    uint32_t now = clock_now();
+
+    disable_rx_isr();
+    memcpy(inputs[MIXER_SOURCE_HOST], report, REPORT_INPUT_BYTES);
+
+    int8_t exclusive = -1;
+    int8_t stick[2] = {-1, -1};
+    uint8_t buttons[REPORT_BUTTON_BYTES] = {0};
+    for (uint8_t source = 0; source < MIXER_SOURCES; source++) {
+        // Without ADAPTER_STREAM_TIMEOUT_MS (or with 0) sources never time out, as for the PC stream
+        if (source != MIXER_SOURCE_HOST && SOURCE_TIMEOUT_TICKS != 0 &&
+            now - lastSubmit[source] > SOURCE_TIMEOUT_TICKS) {
+            active &= ~(1 << source);
+        }
+        if (!(active & (1 << source))) {
+            continue;
+        }
+        const uint8_t *input = inputs[source];
+        if (overrideTicks[source] != 0 && (int32_t) (overrideEnd[source] - now) > 0 &&
+            (exclusive < 0 || priority[source] > priority[exclusive])) {
+            exclusive = source;
+        }
+        for (uint8_t i = 0; i < REPORT_BUTTON_BYTES; i++) {
+            buttons[i] |= input[i];
+        }
+        for (uint8_t s = 0; s < 2; s++) {
+            if (stick_engaged(&input[REPORT_BUTTON_BYTES + 3 * s]) &&
+                (stick[s] < 0 || priority[source] > priority[stick[s]])) {
+                stick[s] = source;
+            }
+        }
+    }
+
+    if (exclusive >= 0) {
+        memcpy(report, inputs[exclusive], REPORT_INPUT_BYTES);
+    } else {
+        memcpy(report, buttons, REPORT_BUTTON_BYTES);
+        for (uint8_t s = 0; s < 2; s++) {
+            uint8_t *analog = &report[REPORT_BUTTON_BYTES + 3 * s];
+            if (stick[s] >= 0) {
+                memcpy(analog, &inputs[stick[s]][REPORT_BUTTON_BYTES + 3 * s], 3);
+            } else {
+                analog[0] = CENTER & 0xFF;
+                analog[1] = CENTER >> 8;
+                analog[2] = CENTER >> 4;
+            }
+        }
+    }
+    enable_rx_isr();
+}
+
+#endif
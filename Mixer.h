@@ -0,0 +1,32 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include "datatypes.h"
+
+/*
+ * Input source mixer, compiled in with ADAPTER_MIXER.
+ *
+ * Every source has a fixed slot holding its last input state (the HOSTLINK_INPUT_STATE layout). MIXER_SOURCE_HOST
+ * is the PC stream, already resolved into the report by the input latch; the others are fed with mixer_submit(),
+ * from HOSTLINK_SOURCE_STATE frames or from board code such as a physical stick. mixer_resolve() merges them into
+ * the report once per 0x30 report:
+ *   - buttons are ORed over all sources
+ *   - each stick comes from the highest priority source holding it outside ADAPTER_MIXER_DEADZONE, else centered
+ *   - a source with an override window takes over alone (buttons and sticks) for that long after each change of its
+ *     state. If several windows are open the highest priority source wins.
+ * Ties in priority go to the lower source id. Fed sources that haven't been submitted for ADAPTER_STREAM_TIMEOUT_MS
+ * are released, like the PC stream (never without it). The merge is a fixed loop over MIXER_SOURCES slots.
+ */
+typedef enum {
+    MIXER_SOURCE_HOST  = 0, // PC stream (HOSTLINK_INPUT_STATE, through the input latch)
+    MIXER_SOURCE_LOCAL = 1, // Controls wired to the adapter
+    MIXER_SOURCE_MACRO = 2, // Macro player, on the adapter or the PC
+    MIXER_SOURCES,
+} Mixer_Source_t;
+
+bool mixer_submit(uint8_t source, const uint8_t *state);
+void mixer_host_changed(void);
+void mixer_configure(uint8_t source, uint8_t priority, uint16_t override_ms);
+void mixer_resolve(USB_StandardReport_t *standardReport);
+
+#endif // MIXER_H
@@ -0,0 +1,312 @@
+#include "Record.h"
+#include "Response.h"
+
+#include <avr/eeprom.h>
+
+#ifdef ADAPTER_RECORD_EEPROM_SIZE
+
+#define FIFO_SIZE       64 // Must be a power of 2
+#define MAX_TOKEN       (2 + 1 + REPORT_INPUT_BYTES) // Pending run, then a new state with every part
+#define FRAME_DATA      15 // Stream bytes per HOSTLINK_RECORD frame
+#define EMPTY           0xFFFF
+
+static uint8_t EEMEM eeLength[2];
+static uint8_t EEMEM eeStream[ADAPTER_RECORD_EEPROM_SIZE];
+
+static const uint8_t neutral[REPORT_INPUT_BYTES] PROGMEM = {0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80};
+
+// Stream bytes on their way to the EEPROM or the UART. Filled by the main loop, or the RX interrupt when loading.
+static uint8_t fifo[FIFO_SIZE];
+static volatile uint8_t fifoHead = 0;
+static volatile uint8_t fifoTail = 0;
+
+static volatile uint8_t requested = RECORD_IDLE; // Written from the RX interrupt
+static volatile uint8_t mode = RECORD_IDLE;
+static uint8_t state[REPORT_INPUT_BYTES];        // Last recorded or replayed state
+static uint16_t run = 0;                         // Recording: repeats not yet written, playback: repeats left
+static uint16_t position = 0;                    // EEPROM offset written (record, load) or read (replay, export)
+static uint16_t length = 0;                      // Playback and export
+static uint16_t eepromBytes = 0;                 // Leading part of the stream that goes to EEPROM, whole tokens
+static uint16_t lengthValue = 0;
+static uint8_t lengthPending = 0;                // Length bytes still to write to EEPROM
+static bool finishing = false;                   // Write the length once the FIFO is empty
+static Record_Stats_t stats;
+
+static uint8_t fifo_count(void) {
+    return (uint8_t) (fifoHead - fifoTail);
+}
+
+static void fifo_push(const uint8_t *data, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+        fifo[(uint8_t) (fifoHead + i) & (FIFO_SIZE - 1)] = data[i];
+    }
+    fifoHead += n;
+    stats.bytes += n;
+}
+
+// A token goes to EEPROM only if it fits entirely and nothing before it was sent to the UART
+static void push_token(const uint8_t *token, uint8_t n) {
+    if (stats.bytes == eepromBytes && eepromBytes + n <= ADAPTER_RECORD_EEPROM_SIZE) {
+        eepromBytes += n;
+    }
+    fifo_push(token, n);
+}
+
+static uint8_t encode_run(uint8_t *out) {
+    if (run == 0) {
+        return 0;
+    }
+    uint16_t count = run - 1;
+    run = 0;
+    if (count < 64) {
+        out[0] = RECORD_RUN_SHORT | count;
+        return 1;
+    }
+    out[0] = RECORD_RUN_LONG | (count >> 8);
+    out[1] = count & 0xFF;
+    return 2;
+}
+
+static uint16_t read_length(void) {
+    return eeprom_read_byte(&eeLength[0]) | (eeprom_read_byte(&eeLength[1]) << 8);
+}
+
+static void begin_write(uint16_t eepromLimit) {
+    stats.bytes = 0;
+    stats.uart_bytes = 0;
+    position = 0;
+    eepromBytes = eepromLimit;
+    lengthValue = 0; // Invalidate the old stream before overwriting it
+    lengthPending = 2;
+    finishing = false;
+}
+
+static void finish_write(void) {
+    lengthValue = stats.bytes < eepromBytes ? stats.bytes : eepromBytes;
+    lengthPending = 2;
+    finishing = true;
+}
+
+static void stop_recording(void) {
+    uint8_t token[2];
+    uint8_t n = encode_run(token);
+    if (FIFO_SIZE - fifo_count() >= n) {
+        push_token(token, n);
+    } else {
+        stats.overruns++;
+    }
+    finish_write();
+}
+
+/*
+ * Request a new mode, from the RX interrupt (HOSTLINK_CONFIG_RECORD_MODE). Only possible from idle, except
+ * for going back to idle.
+ */
+void record_set_mode(uint8_t newMode) {
+    if (newMode <= RECORD_LOADING) {
+        requested = newMode;
+    }
+}
+
+uint8_t record_mode(void) {
+    return mode;
+}
+
+static void apply_mode(uint8_t newMode) {
+    if (newMode == RECORD_IDLE) {
+        if (mode == RECORD_RECORDING) {
+            stop_recording();
+        } else if (mode == RECORD_LOADING) {
+            finish_write();
+        }
+        mode = RECORD_IDLE;
+        return;
+    }
+    if (mode != RECORD_IDLE || fifo_count() != 0 || lengthPending != 0) {
+        return; // Still busy, the request stays pending
+    }
+
+    memcpy_P(state, neutral, REPORT_INPUT_BYTES);
+    run = 0;
+    position = 0;
+    if (newMode == RECORD_RECORDING || newMode == RECORD_LOADING) {
+        stats.frames = 0;
+        begin_write(newMode == RECORD_LOADING ? ADAPTER_RECORD_EEPROM_SIZE : 0);
+    } else {
+        length = read_length();
+        if (length == 0 || length == EMPTY) {
+            requested = RECORD_IDLE;
+            return;
+        }
+        if (length > ADAPTER_RECORD_EEPROM_SIZE) length = ADAPTER_RECORD_EEPROM_SIZE;
+        stats.frames = 0;
+    }
+    mode = newMode;
+}
+
+/*
+ * Record the inputs of a 0x30 report, called once per report while recording.
+ */
+void record_sample(const uint8_t *input) {
+    if (mode != RECORD_RECORDING) {
+        return;
+    }
+    stats.frames++;
+    if (memcmp(state, input, REPORT_INPUT_BYTES) == 0) {
+        if (++run == RECORD_MAX_RUN) {
+            uint8_t token[2];
+            uint8_t n = encode_run(token);
+            if (FIFO_SIZE - fifo_count() < n) goto overrun;
+            push_token(token, n);
+        }
+        return;
+    }
+
+    uint8_t token[MAX_TOKEN];
+    uint8_t n = encode_run(token);
+    uint8_t *changes = &token[n++];
+    *changes = 0;
+    for (uint8_t i = 0; i < REPORT_BUTTON_BYTES; i++) {
+        if (input[i] != state[i]) {
+            *changes |= 1 << i;
+            token[n++] = input[i];
+        }
+    }
+    for (uint8_t s = 0; s < 2; s++) {
+        const uint8_t *stick = &input[REPORT_BUTTON_BYTES + 3 * s];
+        if (memcmp(stick, &state[REPORT_BUTTON_BYTES + 3 * s], 3) != 0) {
+            *changes |= RECORD_CHANGE_LEFT << s;
+            memcpy(&token[n], stick, 3);
+            n += 3;
+        }
+    }
+    if (FIFO_SIZE - fifo_count() < n) goto overrun;
+    push_token(token, n);
+    memcpy(state, input, REPORT_INPUT_BYTES);
+    return;
+
+overrun:
+    // The stream is exact up to the previous report, end it there
+    stats.frames--;
+    stats.overruns++;
+    finish_write();
+    mode = RECORD_IDLE;
+    requested = RECORD_IDLE;
+}
+
+/*
+ * Write the next recorded state into the report, called once per 0x30 report during playback. Playback ends, and
+ * the inputs are released, after the last state.
+ */
+void record_replay(USB_StandardReport_t *standardReport) {
+    if (run > 0) {
+        run--;
+    } else if (position >= length) {
+        memcpy_P(state, neutral, REPORT_INPUT_BYTES);
+        mode = RECORD_IDLE;
+        requested = RECORD_IDLE;
+    } else {
+        uint8_t token = eeprom_read_byte(&eeStream[position++]);
+        if (token & RECORD_RUN_SHORT) {
+            run = token & 0x3F;
+            if ((token & RECORD_RUN_LONG) == RECORD_RUN_LONG) {
+                run = (run << 8) | eeprom_read_byte(&eeStream[position++]);
+            }
+        } else {
+            for (uint8_t i = 0; i < REPORT_BUTTON_BYTES; i++) {
+                if (token & (1 << i)) {
+                    state[i] = eeprom_read_byte(&eeStream[position++]);
+                }
+            }
+            for (uint8_t s = 0; s < 2; s++) {
+                if (token & (RECORD_CHANGE_LEFT << s)) {
+                    for (uint8_t i = 0; i < 3; i++) {
+                        state[REPORT_BUTTON_BYTES + 3 * s + i] = eeprom_read_byte(&eeStream[position++]);
+                    }
+                }
+            }
+        }
+        stats.frames++;
+    }
+    memcpy(REPORT_BUTTONS(standardReport), state, REPORT_INPUT_BYTES);
+}
+
+/*
+ * Append a HOSTLINK_RECORD_LOAD payload to the stream, from the RX interrupt.
+ */
+void record_load(const uint8_t *data, uint8_t n) {
+    if (mode != RECORD_LOADING) {
+        return;
+    }
+    if (FIFO_SIZE - fifo_count() < n || stats.bytes + n > ADAPTER_RECORD_EEPROM_SIZE) {
+        stats.overruns++;
+        return;
+    }
+    fifo_push(data, n);
+}
+
+static void send_frame(uint8_t kind, uint8_t n, bool fromFifo) {
+    uint8_t payload[1 + FRAME_DATA];
+    payload[0] = kind;
+    for (uint8_t i = 0; i < n; i++) {
+        if (fromFifo) {
+            payload[1 + i] = fifo[(uint8_t) (fifoTail + i) & (FIFO_SIZE - 1)];
+        } else {
+            payload[1 + i] = eeprom_read_byte(&eeStream[position + i]);
+        }
+    }
+    hostlink_send_frame(HOSTLINK_RECORD, payload, 1 + n);
+    if (fromFifo) {
+        fifoTail += n;
+    } else {
+        position += n;
+    }
+}
+
+/*
+ * Apply mode requests and move the stream between the FIFO, the EEPROM and the UART. Writes at most one EEPROM byte
+ * per call, and only when the EEPROM is ready, so the main loop never waits for it.
+ */
+void record_task(void) {
+    uint8_t newMode = requested;
+    if (newMode != mode) {
+        disable_rx_isr(); // Loading pushes from the RX interrupt
+        apply_mode(newMode);
+        enable_rx_isr();
+    }
+
+    bool frameFits = hostlink_tx_free() >= HOSTLINK_FRAME_OVERHEAD + 1 + FRAME_DATA;
+    uint8_t count = fifo_count();
+    if (lengthPending != 0 && (!finishing || count == 0)) {
+        if (eeprom_is_ready()) {
+            lengthPending--;
+            eeprom_write_byte(&eeLength[1 - lengthPending], lengthPending ? lengthValue & 0xFF : lengthValue >> 8);
+        }
+    } else if (count != 0 && position < eepromBytes) {
+        if (eeprom_is_ready()) {
+            eeprom_write_byte(&eeStream[position++], fifo[fifoTail & (FIFO_SIZE - 1)]);
+            fifoTail++;
+        }
+    } else if (count != 0 && frameFits) {
+        uint8_t n = count < FRAME_DATA ? count : FRAME_DATA;
+        stats.uart_bytes += n;
+        send_frame(RECORD_FRAME_LIVE, n, true);
+    }
+
+    if (mode == RECORD_EXPORTING && frameFits) {
+        uint16_t left = length - position;
+        if (left == 0) {
+            send_frame(RECORD_FRAME_END, 0, false);
+            mode = RECORD_IDLE;
+            requested = RECORD_IDLE;
+        } else {
+            send_frame(RECORD_FRAME_EXPORT, left < FRAME_DATA ? left : FRAME_DATA, false);
+        }
+    }
+}
+
+const Record_Stats_t *get_record_stats(void) {
+    return &stats;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "datatypes.h"
+
+/*
+ * Input recording and playback, compiled in with ADAPTER_RECORD_EEPROM_SIZE (bytes of EEPROM used).
+ *
+ * While recording, the inputs of every 0x30 report (as sent, after the whole report pipeline) are encoded into a
+ * byte stream, written to EEPROM from the main loop one byte at a time. Once the EEPROM area is full the rest of the
+ * stream goes to the PC as HOSTLINK_RECORD frames. Playback replays the EEPROM part one state per 0x30 report, so
+ * it is exact to the frame. The stream can be exported to the PC and loaded into another adapter.
+ *
+ * Stream tokens, starting from the neutral state:
+ *   0x01-0x1F  new state: the RECORD_CHANGE_* bits say which parts follow, in bit order
+ *   0x80-0xBF  the previous state again for 1-64 reports (low 6 bits + 1)
+ *   0xC0-0xFF  followed by one byte: the previous state again for 1-16384 reports (14 bit count + 1)
+ * The EEPROM holds the stream length (16 bit LE, 0 or 0xFFFF = empty), then the stream.
+ *
+ * The mode is set with HOSTLINK_CONFIG_RECORD_MODE and takes effect from the main loop. Recording stops by itself if
+ * the EEPROM can't keep up with the stream (about 290 bytes per second), counted as an overrun; what was recorded
+ * until then stays exact. Loading expects HOSTLINK_RECORD_LOAD frames no faster than the EEPROM writes them.
+ */
+typedef enum {
+    RECORD_IDLE      = 0,
+    RECORD_RECORDING = 1,
+    RECORD_REPLAYING = 2,
+    RECORD_EXPORTING = 3, // Back to idle once the stream is sent
+    RECORD_LOADING   = 4,
+} Record_Mode_t;
+
+#define RECORD_CHANGE_BUTTONS 0x07 // One bit per button byte
+#define RECORD_CHANGE_LEFT    0x08 // 3 bytes
+#define RECORD_CHANGE_RIGHT   0x10 // 3 bytes
+#define RECORD_RUN_SHORT      0x80
+#define RECORD_RUN_LONG       0xC0
+#define RECORD_MAX_RUN        16384
+
+// First byte of a HOSTLINK_RECORD frame, the stream bytes follow
+#define RECORD_FRAME_LIVE     0x00 // Recorded after the EEPROM filled up
+#define RECORD_FRAME_EXPORT   0x01
+#define RECORD_FRAME_END      0x02 // Export complete, no data
+
+typedef struct {
+    uint32_t frames;     // Reports recorded or replayed
+    uint16_t bytes;      // Stream size of the last recording or load
+    uint16_t uart_bytes; // Part of it sent to the PC because the EEPROM was full
+    uint16_t overruns;   // Recordings stopped and load bytes dropped because the EEPROM couldn't keep up
+} Record_Stats_t;
+
+void record_set_mode(uint8_t mode);
+uint8_t record_mode(void);
+void record_sample(const uint8_t *input);
+void record_replay(USB_StandardReport_t *standardReport);
+void record_load(const uint8_t *data, uint8_t length);
+void record_task(void);
+const Record_Stats_t *get_record_stats(void);
+
+#endif // RECORD_H
@@ -0,0 +1,159 @@
+#include "Remap.h"
+#include "Response.h"
+
+#include <avr/eeprom.h>
+
+#ifdef ADAPTER_REMAP_LAYERS
+
+#define REMAP_EEPROM_MAGIC 0xA7 // Changes when the EEPROM layout does
+#define REMAP_NIBBLES      (REMAP_BUTTONS / 4)
+#define COMBO_HOLD_TICKS   CLOCK_US_TO_TICKS(ADAPTER_REMAP_HOLD_MS * 1000UL)
+
+static uint8_t EEMEM eeMagic;
+static uint8_t EEMEM eeMaps[ADAPTER_REMAP_LAYERS][REMAP_BUTTONS];
+
+static const uint8_t combo[REPORT_BUTTON_BYTES] PROGMEM = ADAPTER_REMAP_COMBO;
+
+// Written from the RX interrupt, read with it disabled
+static uint8_t maps[ADAPTER_REMAP_LAYERS][REMAP_BUTTONS];
+static volatile uint8_t layer = 0;
+static volatile bool rebuild = true;     // The active layer changed, the tables need recompiling
+static volatile bool dirty = false;      // The maps changed since the current save started
+
+// Main loop only
+static bool saving = false;
+static uint8_t saveIndex = 0;
+static uint8_t table[REMAP_NIBBLES][16][REPORT_BUTTON_BYTES];
+static bool identity = true;
+static bool comboHeld = false;
+static bool comboDone = false; // The layer already switched during this hold
+static uint32_t comboStart = 0;
+
+/*
+ * Load the maps from EEPROM, or start with every layer unmapped (each button to itself).
+ */
+void remap_init(void) {
+    if (eeprom_read_byte(&eeMagic) == REMAP_EEPROM_MAGIC) {
+        eeprom_read_block(maps, eeMaps, sizeof(maps));
+    } else {
+        for (uint8_t l = 0; l < ADAPTER_REMAP_LAYERS; l++) {
+            for (uint8_t b = 0; b < REMAP_BUTTONS; b++) {
+                maps[l][b] = b;
+            }
+        }
+    }
+    rebuild = true;
+}
+
+static void compile_layer(void) {
+    uint8_t map[REMAP_BUTTONS];
+    disable_rx_isr();
+    memcpy(map, maps[layer], REMAP_BUTTONS);
+    rebuild = false;
+    enable_rx_isr();
+
+    identity = true;
+    memset(table, 0, sizeof(table));
+    for (uint8_t source = 0; source < REMAP_BUTTONS; source++) {
+        uint8_t destination = map[source];
+        identity &= destination == source;
+        if (destination >= REMAP_BUTTONS) continue;
+
+        uint8_t nibble = source >> 2;
+        uint8_t bit = 1 << (source & 3);
+        for (uint8_t value = 0; value < 16; value++) {
+            if (value & bit) {
+                table[nibble][value][destination >> 3] |= 1 << (destination & 7);
+            }
+        }
+    }
+}
+
+/*
+ * Recompile the tables after a layer or map change, and write changed maps to EEPROM, one byte per call so the
+ * main loop never waits for the EEPROM.
+ */
+void remap_task(void) {
+    if (rebuild) {
+        compile_layer();
+    }
+    if ((dirty || saving) && eeprom_is_ready()) {
+        disable_rx_isr();
+        if (dirty) {
+            dirty = false;
+            saving = true;
+            saveIndex = 0; // Start over, the new value may be behind the write position
+        }
+        uint8_t value = saveIndex < sizeof(maps) ? ((uint8_t *) maps)[saveIndex] : 0;
+        enable_rx_isr();
+        if (saveIndex < sizeof(maps)) {
+            eeprom_update_byte(&((uint8_t *) eeMaps)[saveIndex], value);
+            saveIndex++;
+        } else {
+            // Its own step, so it waits for the last map byte through eeprom_is_ready() instead of busy-waiting
+            eeprom_update_byte(&eeMagic, REMAP_EEPROM_MAGIC);
+            saving = false; // A change that came in meanwhile has set 'dirty' again and starts another pass
+        }
+    }
+}
+
+/*
+ * Called from the RX interrupt with a HOSTLINK_REMAP payload.
+ */
+void remap_set(uint8_t l, uint8_t source, uint8_t destination) {
+    if (l >= ADAPTER_REMAP_LAYERS || source >= REMAP_BUTTONS) return;
+    if (destination >= REMAP_BUTTONS) destination = REMAP_NONE;
+    maps[l][source] = destination;
+    dirty = true;
+    if (l == layer) {
+        rebuild = true;
+    }
+}
+
+void remap_select_layer(uint8_t l) {
+    if (l >= ADAPTER_REMAP_LAYERS) return;
+    layer = l;
+    rebuild = true;
+}
+
+uint8_t remap_layer(void) {
+    return layer;
+}
+
+/*
+ * Remap the button bytes of the next 0x30 report, called once per report.
+ * The layer combo is checked on the buttons as received, before remapping.
+ */
+void remap_apply(uint8_t *buttons) {
+    bool held = true;
+    for (uint8_t i = 0; i < REPORT_BUTTON_BYTES; i++) {
+        uint8_t mask = pgm_read_byte(&combo[i]);
+        held &= (buttons[i] & mask) == mask;
+    }
+    if (!held) {
+        comboHeld = false;
+    } else if (!comboHeld) {
+        comboHeld = true;
+        comboDone = false;
+        comboStart = clock_now();
+    } else if (!comboDone && clock_now() - comboStart >= COMBO_HOLD_TICKS) {
+        comboDone = true;
+        disable_rx_isr();
+        remap_select_layer(layer + 1 < ADAPTER_REMAP_LAYERS ? layer + 1 : 0);
+        enable_rx_isr();
+    }
+
+    if (identity) return;
+
+    uint8_t out[REPORT_BUTTON_BYTES] = {0};
+    for (uint8_t n = 0; n < REMAP_NIBBLES; n++) {
+        uint8_t value = (n & 1) ? buttons[n >> 1] >> 4 : buttons[n >> 1] & 0x0F;
+        const uint8_t *entry = table[n][value];
+        out[0] |= entry[0];
+        out[1] |= entry[1];
+        out[2] |= entry[2];
+    }
+    memcpy(buttons, out, REPORT_BUTTON_BYTES);
+}
+
+#endif // ADAPTER_REMAP_LAYERS
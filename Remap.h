@@ -0,0 +1,26 @@
+#ifndef REMAP_H
+#define REMAP_H
+
+#include "datatypes.h"
+
+/*
+ * Button remapping with layers, compiled in with ADAPTER_REMAP_LAYERS.
+ *
+ * Each layer maps every button bit of the report (0 = Y ... 23 = ZL, see REPORT_BUTTONS) to a destination bit, or
+ * to REMAP_NONE to drop it. Several sources may share a destination. The maps are kept in EEPROM and loaded at
+ * startup; changes from the PC are written back from the main loop.
+ *
+ * The active layer is compiled into one lookup table per source nibble: 6 lookups and 18 ORs remap all 24 buttons,
+ * whatever the map. Holding ADAPTER_REMAP_COMBO for ADAPTER_REMAP_HOLD_MS switches to the next layer.
+ */
+#define REMAP_BUTTONS (REPORT_BUTTON_BYTES * 8)
+#define REMAP_NONE    0xFF
+
+void remap_init(void);
+void remap_task(void);
+void remap_set(uint8_t layer, uint8_t source, uint8_t destination);
+void remap_select_layer(uint8_t layer);
+uint8_t remap_layer(void);
+void remap_apply(uint8_t *buttons);
+
+#endif // REMAP_H
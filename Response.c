@@ -1,171 +1,329 @@
 #include "Response.h"
 
-#define COUNTER_INCREMENT 3
-
-static bool startReport = false;
-static bool imu_enable = false;
+// The timer byte counts 5 ms units (3 per 15 ms Bluetooth report), derived from the hardware clock
+#define TIMER_TICKS_PER_UNIT ((uint16_t) CLOCK_US_TO_TICKS(5000))
+// 0x21 reply: id, timer, standard report, ack, subcommand, then address (4 bytes) and size before the SPI data
+#define SPI_REPLY_MAX_DATA (JOYSTICK_EPSIZE - 4 - sizeof(USB_StandardReport_t) - 5)
+// 0x3F report: id, 2 button bytes, hat, then 4 stick axes as 16 bit little-endian values
+#define SIMPLE_REPORT_SIZE 12
+#define HAT_NEUTRAL 8
+#ifdef ADAPTER_REPORT_PACING_MS
+#define PACING_PERIOD_TICKS CLOCK_US_TO_TICKS(ADAPTER_REPORT_PACING_MS * 1000UL)
+#else
+#define SIMPLE_PERIOD_TICKS CLOCK_US_TO_TICKS(ADAPTER_IN_POLL_MS * 1000UL)
+#endif
 
 // Private functions (definition)
 static void prepare_reply(uint8_t code, uint8_t command, uint8_t data[], uint8_t length);
+static uint8_t *begin_uart_reply(uint8_t code, uint8_t subcommand);
 static void prepare_uart_reply(uint8_t code, uint8_t subcommand, uint8_t data[], uint8_t length);
+static void prepare_uart_reply_P(uint8_t code, uint8_t subcommand, const uint8_t *data, uint8_t length);
 static void prepare_spi_reply(SPI_Address_t address, size_t size);
-static void prepare_standard_report(USB_StandardReport_t *standardReport);
-static void prepare_extended_report(USB_ExtendedReport_t *extendedReport);
+static void prepare_input_report(USB_ExtendedReport_t *report);
+static void prepare_standard_report(uint8_t id, USB_StandardReport_t *standardReport);
+static void prepare_extended_report(uint8_t id, USB_ExtendedReport_t *extendedReport);
+static void prepare_simple_report(USB_StandardReport_t *standardReport);
 static void prepare_8101(void);
+static void get_mac_address(uint8_t *mac);
+static uint8_t advance_timer(void);
+static bool report_due(void);
+static void handle_device_info(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void handle_spi_flash_read(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void handle_set_player_lights(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void handle_get_player_lights(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void handle_set_input_report_mode(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void handle_set_home_lights(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void handle_enable_imu(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void handle_enable_vibration(uint8_t ack, uint8_t subcommand, uint8_t *args);
+static void set_console_state(uint8_t *field, uint8_t value, uint8_t event);
+static void handle_read_imu_registers(uint8_t ack, uint8_t subcommand, uint8_t *args);
 
 // Variables
 uint8_t mac_address[] = {0xD4, 0xF0, 0x57, 0x8D, 0x74, 0x23};
-static uint8_t replyBuffer[JOYSTICK_EPSIZE];
-static uint8_t counter = 0;
-static bool nextPacketReady = false;
-bool (*before_send)(void) = 0;
-static USB_ExtendedReport_t **selectedReportPtr;
+
+// Protocol state of one emulated controller, see response_select()
+typedef struct {
+    bool startReport;
+    Console_State_t console_state;
+    uint8_t console_state_changes; // One bit per HostLink event, in HOSTLINK_EVENT_PLAYER_LIGHTS order
+    uint8_t replyBuffer[JOYSTICK_EPSIZE];
+    uint8_t replyLength; // Bytes of replyBuffer to send, only 0x3F reports are shorter
+    uint8_t lastSimpleReport[SIMPLE_REPORT_SIZE];
+    bool lastSimpleReportValid; // Cleared to send the next 0x3F report even if nothing changed
+    uint8_t counter;
+    uint32_t timer_stamp;
+    uint16_t timer_remainder;
+#ifdef ADAPTER_REPORT_PACING_MS
+    uint32_t pacing_deadline;
+    Pacing_Stats_t pacing_stats;
+#else
+    uint32_t simple_deadline; // Next 0x3F report period, see report_due()
+#endif
+    bool nextPacketReady;
+    bool (*before_send)(void);
+    USB_ExtendedReport_t **selectedReportPtr;
+    Interface_Stats_t interface_stats;
+} Response_Context_t;
+
+static Response_Context_t contexts[JOYSTICK_COUNT] = {
+    [0 ... JOYSTICK_COUNT - 1] = {.console_state = {.report_mode = 0x30}, .replyLength = JOYSTICK_EPSIZE},
+};
+static Response_Context_t *ctx = &contexts[0];
+static uint8_t player = 0; // Index of ctx, the controller selected with response_select()
+
+// Subcommand dispatch
+// Subcommands with a handler build their own reply, the others are answered with 'ack' and the static 'payload'
+typedef void (*Subcommand_Handler_t)(uint8_t ack, uint8_t subcommand, uint8_t *args);
+
+typedef struct {
+    uint8_t ack;                  // 0 = unknown subcommand
+    uint8_t length;               // Length of 'payload'
+    const uint8_t *payload;       // Stored in flash
+    Subcommand_Handler_t handler; // NULL = reply with 'payload'
+} Subcommand_Entry_t;
+
+static const uint8_t pairing_payload[] PROGMEM = {0x03};
+static const uint8_t page_list_payload[] PROGMEM = {0x01}; // Host list present
+static const uint8_t spi_write_payload[] PROGMEM = {0x01}; // Write protected, emulated flash is read only
+static const uint8_t nfc_ir_config_payload[] PROGMEM = {0x01, 0x00, 0xFF, 0x00, 0x03, 0x00, 0x05, 0x01};
+static const uint8_t regulated_voltage_payload[] PROGMEM = {0x83, 0x06}; // 1667 mV, little-endian
+static const uint8_t trigger_elapsed_payload[14] PROGMEM = {0}; // L, R, ZL, ZR, SL, SR, HOME (10ms units)
+
+// Indexed by subcommand id, so lookup is a single flash read
+// https://github.com/dekuNukem/Nintendo_Switch_Reverse_Engineering/blob/master/bluetooth_hid_subcommands_notes.md
+static const Subcommand_Entry_t subcommand_table[SUBCOMMAND_TABLE_SIZE] PROGMEM = {
+    [SUBCOMMAND_CONTROLLER_STATE_ONLY]        = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_BLUETOOTH_MANUAL_PAIRING]     = {0x81, sizeof(pairing_payload), pairing_payload, NULL},
+    [SUBCOMMAND_REQUEST_DEVICE_INFO]          = {0x82, 0, NULL, handle_device_info},
+    [SUBCOMMAND_SET_INPUT_REPORT_MODE]        = {0x80, 0, NULL, handle_set_input_report_mode},
+    [SUBCOMMAND_TRIGGER_BUTTONS_ELAPSED_TIME] = {0x83, sizeof(trigger_elapsed_payload), trigger_elapsed_payload, NULL},
+    [SUBCOMMAND_GET_PAGE_LIST_STATE]          = {0x80, sizeof(page_list_payload), page_list_payload, NULL},
+    [SUBCOMMAND_SET_HCI_STATE]                = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_RESET_PAIRING_INFO]           = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_SET_SHIPMENT_LOW_POWER_STATE] = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_SPI_FLASH_READ]               = {0x90, 0, NULL, handle_spi_flash_read},
+    [SUBCOMMAND_SPI_FLASH_WRITE]              = {0x80, sizeof(spi_write_payload), spi_write_payload, NULL},
+    [SUBCOMMAND_SPI_SECTOR_ERASE]             = {0x80, sizeof(spi_write_payload), spi_write_payload, NULL},
+    [SUBCOMMAND_RESET_NFC_IR_MCU]             = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_SET_NFC_IR_MCU_CONFIG]        = {0xA0, sizeof(nfc_ir_config_payload), nfc_ir_config_payload, NULL},
+    [SUBCOMMAND_SET_NFC_IR_MCU_STATE]         = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_SET_PLAYER_LIGHTS]            = {0x80, 0, NULL, handle_set_player_lights},
+    [SUBCOMMAND_GET_PLAYER_LIGHTS]            = {0xB0, 0, NULL, handle_get_player_lights},
+    [SUBCOMMAND_SET_HOME_LIGHTS]              = {0x80, 0, NULL, handle_set_home_lights},
+    [SUBCOMMAND_ENABLE_IMU]                   = {0x80, 0, NULL, handle_enable_imu},
+    [SUBCOMMAND_SET_IMU_SENSITIVITY]          = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_WRITE_IMU_REGISTERS]          = {0x80, 0, NULL, NULL},
+    [SUBCOMMAND_READ_IMU_REGISTERS]           = {0xC0, 0, NULL, handle_read_imu_registers},
+    [SUBCOMMAND_ENABLE_VIBRATION]             = {0x80, 0, NULL, handle_enable_vibration},
+    [SUBCOMMAND_GET_REGULATED_VOLTAGE]        = {0xD0, sizeof(regulated_voltage_payload), regulated_voltage_payload, NULL},
+};
+
+#ifdef ADAPTER_SUBCOMMAND_STATS
+static uint16_t subcommand_hits[SUBCOMMAND_TABLE_SIZE];
+#endif
+
+/*
+ * Select the controller the other functions work on, 0 or 1 with ADAPTER_DUAL (0 otherwise). Each one has its own
+ * console session, reply buffer and input report, like LUFA's Endpoint_SelectEndpoint().
+ */
+void response_select(uint8_t index) {
+    player = index;
+    ctx = &contexts[index];
+}
 
 void setup_response_manager(bool (*before_callback)(void), USB_ExtendedReport_t **ptr) {
-    before_send = before_callback;
-    selectedReportPtr = ptr;
+    ctx->before_send = before_callback;
+    ctx->selectedReportPtr = ptr;
 
     // Initial value for IN endpoint buffer
     prepare_8101();
 }
 
+/*
+ * Forget the console's session: called when the bus is reset, suspended or disconnected, so the next handshake starts
+ * from the same state as after power-up. Changed console state is reported to the PC like any other change.
+ */
+void reset_response_manager(void) {
+    ctx->startReport = false;
+    ctx->nextPacketReady = false;
+    ctx->counter = 0;
+    ctx->timer_stamp = clock_now();
+    ctx->timer_remainder = 0;
+    ctx->lastSimpleReportValid = false;
+#ifdef ADAPTER_REPORT_PACING_MS
+    ctx->pacing_deadline = ctx->timer_stamp;
+#else
+    ctx->simple_deadline = ctx->timer_stamp;
+#endif
+    set_console_state(&ctx->console_state.player_lights, 0, HOSTLINK_EVENT_PLAYER_LIGHTS);
+    set_console_state(&ctx->console_state.home_light, 0, HOSTLINK_EVENT_HOME_LIGHT);
+    set_console_state(&ctx->console_state.report_mode, 0x30, HOSTLINK_EVENT_REPORT_MODE);
+    set_console_state((uint8_t *) &ctx->console_state.imu_enable, false, HOSTLINK_EVENT_IMU);
+    set_console_state((uint8_t *) &ctx->console_state.vibration_enable, false, HOSTLINK_EVENT_VIBRATION);
+    prepare_8101();
+}
+
 void process_OUT_report(uint8_t* ReportData, uint8_t ReportSize) {
+    ctx->interface_stats.out_packets++;
+    ctx->interface_stats.out_bytes += ReportSize;
+#ifdef ADAPTER_TRACE
+    trace_packet(player ? TRACE_FLAG_PLAYER_2 : 0, ReportData, ReportSize);
+#endif
     // https://github.com/dekuNukem/Nintendo_Switch_Reverse_Engineering/blob/master/bluetooth_hid_subcommands_notes.md
     if (ReportData[0] == 0x80) {
         switch (ReportData[1]) {
             case 0x01: {
-                //Serial_SendString("response8001\n");
+                LOG(LOG_RESPONSE_8001);
                 prepare_8101();
                 break;
             }
             case 0x02:
             case 0x03: {
-                //Serial_SendString("response8002\n");
+                LOG(LOG_RESPONSE_8002, ReportData[1]);
                 prepare_reply(0x81, ReportData[1], NULL, 0);
                 break;
             }
             case 0x04: {
-                //Serial_SendString("response8004\n");
-                startReport = true;
-                prepare_standard_report(&((*selectedReportPtr)->standardReport));
+                LOG(LOG_RESPONSE_8004);
+                ctx->startReport = true;
+                prepare_input_report(*ctx->selectedReportPtr);
                 break;
             }
             case 0x05: {
-                //Serial_SendString("response8005\n");
-                startReport = false;
+                LOG(LOG_RESPONSE_8005);
+                ctx->startReport = false;
                 break;
             }
             default: {
-                // TODO
-                //Serial_SendString("responsedefault\n");
+                // Other commands aren't implemented, acknowledge them like 0x02 and 0x03 so the console doesn't wait
+                LOG(LOG_RESPONSE_80, ReportData[1]);
                 prepare_reply(0x81, ReportData[1], NULL, 0);
                 break;
             }
         }
     } else if (ReportData[0] == 0x01 && ReportSize > 16) {
         Switch_Subcommand_t subcommand = ReportData[10];
-        switch (subcommand) {
-            case SUBCOMMAND_BLUETOOTH_MANUAL_PAIRING: {
-                //Serial_SendString("responsebmp\n");
-                prepare_uart_reply(0x81, subcommand, (uint8_t *) 0x03, 1);
-                break;
-            }
-            case SUBCOMMAND_REQUEST_DEVICE_INFO: {
-                //Serial_SendString("responserdi\n");
-                size_t n = sizeof(mac_address); // = 6
-                uint8_t buf[n + 6];
-                buf[0] = 0x03; buf[1] = 0x48; // Firmware version
-                buf[2] = 0x03; // Pro Controller
-                buf[3] = 0x02; // Unkown
-                // MAC address is flipped (big-endian)
-                for (unsigned int i = 0; i < n; i++) {
-                    buf[(n + 3) - i] = mac_address[i];
-                }
-                buf[n + 4] = 0x03; // Unknown
-                buf[n + 5] = 0x02; // Use colors in SPI memory, and use grip colors (added in Switch firmware 5.0)
-                prepare_uart_reply(0x82, subcommand, buf, sizeof(buf));
-                break;
-            }
-            case SUBCOMMAND_SET_INPUT_REPORT_MODE:
-            case SUBCOMMAND_SET_SHIPMENT_LOW_POWER_STATE:
-            case SUBCOMMAND_SET_PLAYER_LIGHTS:
-            case SUBCOMMAND_SET_HOME_LIGHTS:
-            case SUBCOMMAND_ENABLE_VIBRATION: {
-                //Serial_SendString("responseset\n");
-                prepare_uart_reply(0x80, subcommand, NULL, 0);
-                break;
-            }
-            case SUBCOMMAND_ENABLE_IMU: {
-                //Serial_SendString("responseimu\n");
-                if (ReportData[11] == 0)
-                {
-                    imu_enable = false;
-                }
-                else
-                {
-                    imu_enable = true;
-                }
-                prepare_uart_reply(0x80, subcommand, NULL, 0);
-                break;
-            }
-            case SUBCOMMAND_TRIGGER_BUTTONS_ELAPSED_TIME: {
-                //Serial_SendString("responsetbe\n");
-                prepare_uart_reply(0x83, subcommand, NULL, 0);
-                break;
-            }
-            case SUBCOMMAND_SET_NFC_IR_MCU_CONFIG: {
-                //Serial_SendString("responsesnfc\n");
-                uint8_t buf[] = {0x01, 0x00, 0xFF, 0x00, 0x03, 0x00, 0x05, 0x01};
-                prepare_uart_reply(0xA0, subcommand, buf, sizeof(buf));
-                break;
-            }
-            case SUBCOMMAND_SPI_FLASH_READ: {
-                //Serial_SendString("responsespr\n");
-                // SPI
-                // Addresses are little-endian, so 80 60 means address 0x6080
-                SPI_Address_t address = (ReportData[12] << 8) | ReportData[11];
-                size_t size = (size_t) ReportData[15];
-                prepare_spi_reply(address, size);
-                break;
-            }
-            default: {
-                // TODO
-                //Serial_SendString("responsedefault\n");
-                prepare_uart_reply(0x80, subcommand, NULL, 0);
-                break;
-            }
+        Subcommand_Entry_t entry = {0};
+        if (subcommand < SUBCOMMAND_TABLE_SIZE) {
+            memcpy_P(&entry, &subcommand_table[subcommand], sizeof(Subcommand_Entry_t));
+#ifdef ADAPTER_SUBCOMMAND_STATS
+            subcommand_hits[subcommand]++;
+#endif
+        }
+        if (entry.ack == 0) {
+            // Unknown subcommand, plain ACK
+            LOG(LOG_SUBCOMMAND, subcommand);
+            prepare_uart_reply(0x80, subcommand, NULL, 0);
+        } else if (entry.handler != NULL) {
+            entry.handler(entry.ack, subcommand, &ReportData[11]);
+        } else {
+            prepare_uart_reply_P(entry.ack, subcommand, entry.payload, entry.length);
         }
     }
 }
 
-void send_IN_report(void) {
-    //Serial_SendString("send_IN_report\n");
-    if (!nextPacketReady && before_send()) {
-        // No requests from Switch, use standard report
-        if (startReport)
-        {
-            if (imu_enable)
-            {
-                //Serial_SendString("imu_enable\n");
-                prepare_extended_report(*selectedReportPtr);
-            }
-            else
-            {
-                //Serial_SendString("imu_disable\n");
-                prepare_standard_report(&((*selectedReportPtr)->standardReport));
-            }
+#ifdef ADAPTER_SUBCOMMAND_STATS
+uint16_t subcommand_hit_count(uint8_t subcommand) {
+    return subcommand < SUBCOMMAND_TABLE_SIZE ? subcommand_hits[subcommand] : 0;
+}
+#endif
+
+const Interface_Stats_t *get_interface_stats(void) {
+    return &ctx->interface_stats;
+}
+
+#ifdef ADAPTER_REPORT_PACING_MS
+const Pacing_Stats_t *get_pacing_stats(void) {
+    return &ctx->pacing_stats;
+}
+#endif
+
+/*
+ * Timer byte of the latest report, which the PC uses to match its input to reports
+ */
+uint8_t get_report_counter(void) {
+    return ctx->counter;
+}
+
+const Console_State_t *get_console_state(void) {
+    return &ctx->console_state;
+}
+
+/*
+ * Push pending console state changes to the PC, one event per call, for every controller (the second one's events
+ * are tagged with HOSTLINK_PLAYER_2). Only the latest value of each field is sent, and nothing is sent while the UART
+ * queue is full.
+ */
+void console_events_task(void) {
+    for (uint8_t i = 0; i < JOYSTICK_COUNT; i++) {
+        Response_Context_t *c = &contexts[i];
+#ifdef ADAPTER_CONSOLE_EVENTS
+        if (c->console_state_changes == 0) continue;
+
+        uint8_t bit = 0;
+        while (!(c->console_state_changes & (1 << bit))) bit++;
+
+        uint8_t value;
+        switch (HOSTLINK_EVENT_PLAYER_LIGHTS + bit) {
+            case HOSTLINK_EVENT_PLAYER_LIGHTS: value = c->console_state.player_lights; break;
+            case HOSTLINK_EVENT_HOME_LIGHT:    value = c->console_state.home_light; break;
+            case HOSTLINK_EVENT_REPORT_MODE:   value = c->console_state.report_mode; break;
+            case HOSTLINK_EVENT_IMU:           value = c->console_state.imu_enable; break;
+            default:                           value = c->console_state.vibration_enable; break;
+        }
+        uint8_t type = (HOSTLINK_EVENT_PLAYER_LIGHTS + bit) | (i ? HOSTLINK_PLAYER_2 : 0);
+        if (hostlink_send_frame(type, &value, 1)) {
+            c->console_state_changes &= ~(1 << bit);
         }
+        return;
+#else
+        c->console_state_changes = 0;
+#endif
     }
+}
 
-    if (nextPacketReady)
+/*
+ * Returns true if a reply to the console is waiting to be sent.
+ */
+bool reply_pending(void) {
+    return ctx->nextPacketReady;
+}
+
+/*
+ * Build the next IN packet if needed and write it to the endpoint.
+ * Returns the report id of the packet written, or 0 if there was nothing to send.
+ */
+uint8_t send_IN_report(void) {
+    if (!ctx->nextPacketReady && ctx->startReport && !report_due()) {
+        return 0; // Too early for the next paced report, the host will poll again
+    }
+
+    if (!ctx->nextPacketReady && ctx->startReport && ctx->before_send()) {
+        // No requests from Switch, send an input report
+        prepare_input_report(*ctx->selectedReportPtr);
+    }
+
+    if (ctx->nextPacketReady)
     {
-        //Serial_SendString("sended\n");
-        Endpoint_SelectEndpoint(JOYSTICK_IN_EPADDR);
+        LOG_REPORT(LOG_IN_REPORT, ctx->replyBuffer[0], ctx->console_state.imu_enable);
+#ifdef ADAPTER_BENCH
+        // No USB controller in the simulator, the benchmark provides the endpoint
+        bench_write_IN(ctx->replyBuffer, ctx->replyLength);
+#else
+        Endpoint_SelectEndpoint(JOYSTICK_PLAYER_IN_EPADDR(player));
         while (!Endpoint_IsINReady()); // Wait until IN endpoint is ready
-        while (Endpoint_Write_Stream_LE(&replyBuffer, sizeof(replyBuffer), NULL) != ENDPOINT_RWSTREAM_NoError);
+        while (Endpoint_Write_Stream_LE(ctx->replyBuffer, ctx->replyLength, NULL) != ENDPOINT_RWSTREAM_NoError);
         Endpoint_ClearIN(); // We then send an IN packet on this endpoint.
-        nextPacketReady = false;
+#endif
+        ctx->nextPacketReady = false;
+        ctx->interface_stats.in_packets++;
+        ctx->interface_stats.in_bytes += ctx->replyLength;
+#ifdef ADAPTER_TRACE
+        trace_packet(TRACE_FLAG_IN | (player ? TRACE_FLAG_PLAYER_2 : 0), ctx->replyBuffer, ctx->replyLength);
+#endif
+        return ctx->replyBuffer[0];
     }
+    return 0;
 }
 
 /*
@@ -173,72 +331,309 @@ void send_IN_report(void) {
  */
 
 static void prepare_reply(uint8_t code, uint8_t command, uint8_t data[], uint8_t length) {
-    if (nextPacketReady) return;
-    memset(replyBuffer, 0, sizeof(replyBuffer));
-    replyBuffer[0] = code;
-    replyBuffer[1] = command;
-    memcpy(&replyBuffer[2], &data[0], length);
-    nextPacketReady = true;
+    if (ctx->nextPacketReady) return;
+    memset(ctx->replyBuffer, 0, sizeof(ctx->replyBuffer));
+    ctx->replyLength = sizeof(ctx->replyBuffer);
+    ctx->replyBuffer[0] = code;
+    ctx->replyBuffer[1] = command;
+    memcpy(&ctx->replyBuffer[2], &data[0], length);
+    ctx->nextPacketReady = true;
 }
 
-static void prepare_uart_reply(uint8_t code, uint8_t subcommand, uint8_t data[], uint8_t length) {
-    if (nextPacketReady) return;
-    memset(replyBuffer, 0, sizeof(replyBuffer));
-    replyBuffer[0] = 0x21;
+static uint8_t *begin_uart_reply(uint8_t code, uint8_t subcommand) {
+    if (ctx->nextPacketReady) return NULL;
+    memset(ctx->replyBuffer, 0, sizeof(ctx->replyBuffer));
+    ctx->replyLength = sizeof(ctx->replyBuffer);
+    ctx->replyBuffer[0] = 0x21;
 
-    counter += COUNTER_INCREMENT;
-    replyBuffer[1] = counter;
+    ctx->replyBuffer[1] = advance_timer();
 
     disable_rx_isr();
-    USB_StandardReport_t *selectedReport = &((*selectedReportPtr)->standardReport);
+    USB_StandardReport_t *selectedReport = &((*ctx->selectedReportPtr)->standardReport);
     size_t n = sizeof(USB_StandardReport_t);
     enable_rx_isr();
-    memcpy(&replyBuffer[2], selectedReport, n);
-    replyBuffer[n + 2] = code;
-    replyBuffer[n + 3] = subcommand;
-    memcpy(&replyBuffer[n + 4], &data[0], length);
-    nextPacketReady = true;
+    memcpy(&ctx->replyBuffer[2], selectedReport, n);
+    ctx->replyBuffer[n + 2] = code;
+    ctx->replyBuffer[n + 3] = subcommand;
+    ctx->nextPacketReady = true;
+    return &ctx->replyBuffer[n + 4];
+}
+
+static void prepare_uart_reply(uint8_t code, uint8_t subcommand, uint8_t data[], uint8_t length) {
+    uint8_t *payload = begin_uart_reply(code, subcommand);
+    if (payload == NULL) return;
+    memcpy(payload, &data[0], length);
+}
+
+static void prepare_uart_reply_P(uint8_t code, uint8_t subcommand, const uint8_t *data, uint8_t length) {
+    uint8_t *payload = begin_uart_reply(code, subcommand);
+    if (payload == NULL) return;
+    memcpy_P(payload, data, length);
 }
 
+/*
+ * The flash data is read straight into the reply. The size comes from the console, so it is clamped to what fits
+ * in one packet (SPI_REPLY_MAX_DATA bytes); the size byte of the reply tells the console how much it got.
+ */
 static void prepare_spi_reply(SPI_Address_t address, size_t size) {
-    uint8_t data[size];
+    uint8_t *payload = begin_uart_reply(0x90, SUBCOMMAND_SPI_FLASH_READ);
+    if (payload == NULL) return;
+
+    if (size > SPI_REPLY_MAX_DATA) {
+        size = SPI_REPLY_MAX_DATA;
+    }
+    // Little-endian
+    payload[0] = address & 0xFF;
+    payload[1] = (address >> 8) & 0xFF;
+    payload[2] = 0x00;
+    payload[3] = 0x00;
+    payload[4] = size;
     // Populate buffer with data read from SPI flash
-    spi_read(address, size, data);
+    spi_read(address, size, &payload[5]);
+}
 
-    uint8_t spiReplyBuffer[5 + size];
-    // Big-endian
-    spiReplyBuffer[0] = address & 0xFF;
-    spiReplyBuffer[1] = (address >> 8) & 0xFF;
-    spiReplyBuffer[2] = 0x00;
-    spiReplyBuffer[3] = 0x00;
-    spiReplyBuffer[4] = size;
-    memcpy(&spiReplyBuffer[5], &data[0], size);
+/*
+ * Build the input report in the format the console asked for with SET_INPUT_REPORT_MODE. 0x31 starts like 0x30;
+ * the NFC/IR MCU data after it doesn't fit in a USB packet and is left zeroed. Unknown modes get 0x30 reports.
+ */
+static void prepare_input_report(USB_ExtendedReport_t *report) {
+    switch (ctx->console_state.report_mode) {
+    case 0x3F:
+        prepare_simple_report(&report->standardReport);
+        break;
+    case 0x31:
+        prepare_extended_report(0x31, report);
+        break;
+    default:
+        if (ctx->console_state.imu_enable)
+        {
+            prepare_extended_report(0x30, report);
+        }
+        else
+        {
+            prepare_standard_report(0x30, &report->standardReport);
+        }
+        break;
+    }
+}
 
-    prepare_uart_reply(0x90, SUBCOMMAND_SPI_FLASH_READ, spiReplyBuffer, sizeof(spiReplyBuffer));
+static void prepare_standard_report(uint8_t id, USB_StandardReport_t *standardReport) {
+    if (ctx->nextPacketReady) return;
+    uint8_t timer = advance_timer();
+    disable_rx_isr();
+    prepare_reply(id, timer, (uint8_t *) standardReport, sizeof(USB_StandardReport_t));
+    enable_rx_isr();
 }
 
-static void prepare_standard_report(USB_StandardReport_t *standardReport) {
-    if (nextPacketReady) return;
-    counter += COUNTER_INCREMENT;
+static void prepare_extended_report(uint8_t id, USB_ExtendedReport_t *extendedReport) {
+    if (ctx->nextPacketReady) return;
+    uint8_t timer = advance_timer();
     disable_rx_isr();
-    prepare_reply(0x30, counter, (uint8_t *) standardReport, sizeof(USB_StandardReport_t));
+    prepare_reply(id, timer, (uint8_t *) extendedReport, sizeof(USB_ExtendedReport_t));
     enable_rx_isr();
 }
 
-static void prepare_extended_report(USB_ExtendedReport_t *extendedReport) {
-    if (nextPacketReady) return;
-    counter += COUNTER_INCREMENT;
+// 0x3F hat value for the 4 d-pad bits of the third button byte (DOWN UP RIGHT LEFT), opposite directions cancel
+static const uint8_t hat_table[16] PROGMEM = {
+    HAT_NEUTRAL, 4, 0, HAT_NEUTRAL, 2, 3, 1, 2, 6, 5, 7, 6, HAT_NEUTRAL, 4, 0, HAT_NEUTRAL,
+};
+
+/*
+ * 0x3F simple HID report, the format PC drivers read without a handshake:
+ *   [1] B A Y X L R ZL ZR, [2] - + LS RS HOME CAPTURE SL SR (LSB first), [3] hat (0 up, clockwise, 8 centered)
+ *   [4..11] left X, left Y, right X, right Y, 16 bit little-endian, Y grows downwards like HID axes
+ * It's only sent when it differs from the previous one. It is still built once per poll interval (see report_due()),
+ * so the input steps and the timer advances at the same rate as with 0x30 reports.
+ */
+static void prepare_simple_report(USB_StandardReport_t *standardReport) {
+    if (ctx->nextPacketReady) return;
+    advance_timer();
+    uint8_t input[REPORT_INPUT_BYTES];
     disable_rx_isr();
-    prepare_reply(0x30, counter, (uint8_t *) extendedReport, sizeof(USB_ExtendedReport_t));
+    memcpy(input, REPORT_BUTTONS(standardReport), REPORT_INPUT_BYTES);
     enable_rx_isr();
+
+    uint8_t report[SIMPLE_REPORT_SIZE];
+    report[0] = 0x3F;
+    report[1] = ((input[0] & 0x04) >> 2)   // B
+              | ((input[0] & 0x08) >> 2)   // A
+              | ((input[0] & 0x01) << 2)   // Y
+              | ((input[0] & 0x02) << 2)   // X
+              | ((input[2] & 0x40) >> 2)   // L
+              | ((input[0] & 0x40) >> 1)   // R
+              | ((input[2] & 0x80) >> 1)   // ZL
+              | (input[0] & 0x80);         // ZR
+    report[2] = (input[1] & 0x33)          // - + HOME CAPTURE
+              | ((input[1] & 0x08) >> 1)   // LS
+              | ((input[1] & 0x04) << 1)   // RS
+              | (((input[0] | input[2]) & 0x20) << 1)  // SL of either side
+              | (((input[0] | input[2]) & 0x10) << 3); // SR of either side
+    report[3] = pgm_read_byte(&hat_table[input[2] & 0x0F]);
+    for (uint8_t s = 0; s < 2; s++) {
+        const uint8_t *analog = &input[REPORT_BUTTON_BYTES + 3 * s];
+        uint16_t x = analog[0] | ((analog[1] & 0x0F) << 8);
+        uint16_t y = 0xFFF - ((analog[1] >> 4) | (analog[2] << 4));
+        report[4 + 4 * s] = x << 4;
+        report[5 + 4 * s] = x >> 4;
+        report[6 + 4 * s] = y << 4;
+        report[7 + 4 * s] = y >> 4;
+    }
+
+    if (ctx->lastSimpleReportValid && memcmp(report, ctx->lastSimpleReport, SIMPLE_REPORT_SIZE) == 0) {
+        return;
+    }
+    memcpy(ctx->lastSimpleReport, report, SIMPLE_REPORT_SIZE);
+    ctx->lastSimpleReportValid = true;
+    memcpy(ctx->replyBuffer, report, SIMPLE_REPORT_SIZE);
+    ctx->replyLength = SIMPLE_REPORT_SIZE;
+    ctx->nextPacketReady = true;
+}
+
+/*
+ * Advance the timer byte by the real time elapsed since the previous packet.
+ * The remainder is carried over so irregular polling doesn't accumulate rounding errors.
+ */
+static uint8_t advance_timer(void) {
+    uint32_t now = clock_now();
+    uint32_t elapsed = (now - ctx->timer_stamp) + ctx->timer_remainder;
+    if (elapsed > 0xFFFF) {
+        elapsed = 0xFFFF; // The timer byte has wrapped many times by now, exact value doesn't matter
+    }
+    ctx->timer_stamp = now;
+    ctx->counter += (uint16_t) elapsed / TIMER_TICKS_PER_UNIT;
+    ctx->timer_remainder = (uint16_t) elapsed % TIMER_TICKS_PER_UNIT;
+    return ctx->counter;
+}
+
+/*
+ * With ADAPTER_REPORT_PACING_MS, 0x30 reports are sent on a fixed schedule no matter how fast the host polls.
+ * Deadlines advance by exactly one period so lateness doesn't accumulate, unless a whole period was missed.
+ * Without it, only 0x3F reports need a schedule: an unchanged one isn't written, so the endpoint stays free and
+ * doesn't pace them. They are built once per ADAPTER_IN_POLL_MS like the reports the console polls.
+ */
+static bool report_due(void) {
+#ifndef ADAPTER_REPORT_PACING_MS
+    if (ctx->console_state.report_mode != 0x3F) {
+        return true;
+    }
+    uint32_t now = clock_now();
+    int32_t late = (int32_t) (now - ctx->simple_deadline);
+    if (late < 0) {
+        return false;
+    }
+    if (late >= (int32_t) SIMPLE_PERIOD_TICKS) {
+        ctx->simple_deadline = now;
+    }
+    ctx->simple_deadline += SIMPLE_PERIOD_TICKS;
+#else
+    uint32_t now = clock_now();
+    int32_t late = (int32_t) (now - ctx->pacing_deadline);
+    if (late < 0) {
+        return false;
+    }
+    if (late >= (int32_t) PACING_PERIOD_TICKS) {
+        ctx->pacing_stats.missed++;
+        ctx->pacing_deadline = now;
+    }
+    ctx->pacing_deadline += PACING_PERIOD_TICKS;
+
+    ctx->pacing_stats.reports++;
+    ctx->pacing_stats.late_total += late;
+    if (late > ctx->pacing_stats.late_max) {
+        ctx->pacing_stats.late_max = late > 0xFFFF ? 0xFFFF : late;
+    }
+#endif
+    return true;
 }
 
 static void prepare_8101(void) {
-    if (nextPacketReady) return;
+    if (ctx->nextPacketReady) return;
     size_t n = sizeof(mac_address); // = 6
     uint8_t buf[n + 2];
     buf[0] = 0x00;
     buf[1] = 0x03; // Pro Controller
-    memcpy(&buf[2], &mac_address[0], n);
+    get_mac_address(&buf[2]);
     prepare_reply(0x81, 0x01, buf, sizeof(buf));
 }
+
+// The console tells controllers apart by their address, so each one gets its own
+static void get_mac_address(uint8_t *mac) {
+    memcpy(mac, mac_address, sizeof(mac_address));
+    mac[0] += player;
+}
+
+/*
+ * Subcommand handlers
+ */
+
+static void handle_device_info(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    LOG(LOG_DEVICE_INFO);
+    size_t n = sizeof(mac_address); // = 6
+    uint8_t mac[n];
+    get_mac_address(mac);
+    uint8_t buf[n + 6];
+    buf[0] = 0x03; buf[1] = 0x48; // Firmware version
+    buf[2] = 0x03; // Pro Controller
+    buf[3] = 0x02; // Unkown
+    // MAC address is flipped (big-endian)
+    for (unsigned int i = 0; i < n; i++) {
+        buf[(n + 3) - i] = mac[i];
+    }
+    buf[n + 4] = 0x03; // Unknown
+    buf[n + 5] = 0x02; // Use colors in SPI memory, and use grip colors (added in Switch firmware 5.0)
+    prepare_uart_reply(ack, subcommand, buf, sizeof(buf));
+}
+
+static void handle_spi_flash_read(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    LOG(LOG_SPI_READ, args[0], args[1], args[4]);
+    // Addresses are little-endian, so 80 60 means address 0x6080
+    SPI_Address_t address = (args[1] << 8) | args[0];
+    size_t size = (size_t) args[4];
+    prepare_spi_reply(address, size);
+}
+
+static void set_console_state(uint8_t *field, uint8_t value, uint8_t event) {
+    if (*field != value) {
+        *field = value;
+        ctx->console_state_changes |= 1 << (event - HOSTLINK_EVENT_PLAYER_LIGHTS);
+    }
+}
+
+static void handle_set_player_lights(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    set_console_state(&ctx->console_state.player_lights, args[0], HOSTLINK_EVENT_PLAYER_LIGHTS);
+    prepare_uart_reply(ack, subcommand, NULL, 0);
+}
+
+static void handle_get_player_lights(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    prepare_uart_reply(ack, subcommand, &ctx->console_state.player_lights, 1);
+}
+
+static void handle_set_input_report_mode(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    set_console_state(&ctx->console_state.report_mode, args[0], HOSTLINK_EVENT_REPORT_MODE);
+    ctx->lastSimpleReportValid = false;
+    prepare_uart_reply(ack, subcommand, NULL, 0);
+}
+
+static void handle_set_home_lights(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    // Byte 1, high nibble: LED start intensity. The rest of the 25 bytes is the dimming pattern, not tracked.
+    set_console_state(&ctx->console_state.home_light, args[1] >> 4, HOSTLINK_EVENT_HOME_LIGHT);
+    prepare_uart_reply(ack, subcommand, NULL, 0);
+}
+
+static void handle_enable_imu(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    LOG(LOG_ENABLE_IMU, args[0]);
+    set_console_state((uint8_t *) &ctx->console_state.imu_enable, args[0] != 0, HOSTLINK_EVENT_IMU);
+    prepare_uart_reply(ack, subcommand, NULL, 0);
+}
+
+static void handle_enable_vibration(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    set_console_state((uint8_t *) &ctx->console_state.vibration_enable, args[0] != 0, HOSTLINK_EVENT_VIBRATION);
+    prepare_uart_reply(ack, subcommand, NULL, 0);
+}
+
+static void handle_read_imu_registers(uint8_t ack, uint8_t subcommand, uint8_t *args) {
+    // Echo the start register and count, register values read as 0
+    uint8_t buf[2 + 0x20] = {args[0], args[1]};
+    uint8_t count = args[1] > 0x20 ? 0x20 : args[1];
+    prepare_uart_reply(ack, subcommand, buf, 2 + count);
+}
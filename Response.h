@@ -4,6 +4,10 @@
 #include "datatypes.h"
 #include "Descriptors.h"
 #include "EmulatedSPI.h"
+#include "HostLink.h"
+#include "Clock.h"
+#include "Trace.h"
+#include "Log.h"
 #include <LUFA/Drivers/USB/USB.h>
 
 inline void disable_rx_isr(void) {
@@ -18,9 +22,25 @@ inline void enable_rx_isr(void) {
     UCSR1B |= _BV(RXCIE1);
 }
 
+void response_select(uint8_t index);
 void setup_response_manager(bool (*before_callback)(void), USB_ExtendedReport_t **ptr);
+void reset_response_manager(void);
 void process_OUT_report(uint8_t* ReportData, uint8_t ReportSize);
-void send_IN_report(void);
+uint8_t send_IN_report(void);
+bool reply_pending(void);
+const Console_State_t *get_console_state(void);
+uint8_t get_report_counter(void);
+const Interface_Stats_t *get_interface_stats(void);
+void console_events_task(void);
+#ifdef ADAPTER_BENCH
+void bench_write_IN(const uint8_t *packet, uint8_t length);
+#endif
+#ifdef ADAPTER_SUBCOMMAND_STATS
+uint16_t subcommand_hit_count(uint8_t subcommand);
+#endif
+#ifdef ADAPTER_REPORT_PACING_MS
+const Pacing_Stats_t *get_pacing_stats(void);
+#endif
 //void prepare_extended_report(USB_ExtendedReport_t *extendedReport);
 
 #endif // JOYSTICK_RESPONSE_H
@@ -0,0 +1,38 @@
+// Generated by tools/spi_image.py from the built-in defaults, do not edit
+#ifndef SPI_IMAGE_H
+#define SPI_IMAGE_H
+
+#define SPI_IMAGE_REGIONS 5
+
+static const uint8_t spi_image_data[] PROGMEM = {
+    // 0x6000
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF,
+    // 0x6020
+    0xE6, 0xFF, 0x3A, 0x00, 0x39, 0x00, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+    0xF7, 0xFF, 0xFC, 0xFF, 0x00, 0x00, 0xE7, 0x3B, 0xE7, 0x3B, 0xE7, 0x3B,
+    // 0x603D
+    0xBA, 0x15, 0x62, 0x11, 0xB8, 0x7F, 0x29, 0x06, 0x5B, 0xFF, 0xE7, 0x7E,
+    0x0E, 0x36, 0x56, 0x9E, 0x85, 0x60, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    // 0x6080
+    0x50, 0xFD, 0x00, 0x00, 0xC6, 0x0F, 0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3,
+    0xD4, 0x14, 0x54, 0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63,
+    0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54, 0x41, 0x15, 0x54,
+    0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63,
+    // 0x8010
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xB2, 0xA1,
+    0xBE, 0xFF, 0x3E, 0x00, 0xF0, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+    0xFE, 0xFF, 0xFE, 0xFF, 0x08, 0x00, 0xE7, 0x3B, 0xE7, 0x3B, 0xE7, 0x3B,
+};
+
+static const SPI_Region_t spi_image_index[SPI_IMAGE_REGIONS] PROGMEM = {
+    {0x6000, 16, 0},
+    {0x6020, 24, 16},
+    {0x603D, 32, 40},
+    {0x6080, 42, 72},
+    {0x8010, 48, 114},
+};
+
+#endif // SPI_IMAGE_H
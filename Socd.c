@@ -0,0 +1,75 @@
+#include "Socd.h"
+#include "Response.h"
+
+// Table index: current bits, previous bits << 2, previous result << 4. Bit 0 is down/right, bit 1 is up/left.
+#define CUR(i)   ((i) & 3)
+#define FRESH(i) (3 & ~((i) >> 2)) // Bits that weren't held before, when both are held now
+#define LAST(i)  (((i) >> 4) & 3)
+
+#define SOCD_OFF_ENTRY(i)        CUR(i)
+#define SOCD_NEUTRAL_ENTRY(i)    (CUR(i) == 3 ? 0 : CUR(i))
+#define SOCD_LAST_INPUT_ENTRY(i) (CUR(i) != 3 ? CUR(i) : FRESH(i) == 3 ? 0 : FRESH(i) != 0 ? FRESH(i) : LAST(i))
+#define SOCD_UP_ENTRY(i)         (CUR(i) == 3 ? 2 : CUR(i))
+
+#define ROW4(f, i)  f(i), f((i) + 1), f((i) + 2), f((i) + 3)
+#define ROW16(f, i) ROW4(f, i), ROW4(f, (i) + 4), ROW4(f, (i) + 8), ROW4(f, (i) + 12)
+#define ROW64(f)    {ROW16(f, 0), ROW16(f, 16), ROW16(f, 32), ROW16(f, 48)}
+
+// [mode][axis], axis 0 = down/up, axis 1 = right/left
+static const uint8_t socd_tables[4][2][64] PROGMEM = {
+    [SOCD_OFF]         = {ROW64(SOCD_OFF_ENTRY),        ROW64(SOCD_OFF_ENTRY)},
+    [SOCD_NEUTRAL]     = {ROW64(SOCD_NEUTRAL_ENTRY),    ROW64(SOCD_NEUTRAL_ENTRY)},
+    [SOCD_LAST_INPUT]  = {ROW64(SOCD_LAST_INPUT_ENTRY), ROW64(SOCD_LAST_INPUT_ENTRY)},
+    [SOCD_UP_PRIORITY] = {ROW64(SOCD_UP_ENTRY),         ROW64(SOCD_NEUTRAL_ENTRY)},
+};
+
+// Packed 12-bit stick for each direction combination, full deflection, up is high Y
+#define LEVER_X(d) (((d) & 8) ? 0x000 : ((d) & 4) ? 0xFFF : 0x800)
+#define LEVER_Y(d) (((d) & 2) ? 0xFFF : ((d) & 1) ? 0x000 : 0x800)
+#define LEVER_STICK(d) {LEVER_X(d) & 0xFF, ((LEVER_Y(d) & 0x0F) << 4) | (LEVER_X(d) >> 8), LEVER_Y(d) >> 4}
+
+static const uint8_t lever_sticks[16][3] PROGMEM = {
+    LEVER_STICK(0),  LEVER_STICK(1),  LEVER_STICK(2),  LEVER_STICK(3),
+    LEVER_STICK(4),  LEVER_STICK(5),  LEVER_STICK(6),  LEVER_STICK(7),
+    LEVER_STICK(8),  LEVER_STICK(9),  LEVER_STICK(10), LEVER_STICK(11),
+    LEVER_STICK(12), LEVER_STICK(13), LEVER_STICK(14), LEVER_STICK(15),
+};
+
+// Written from the RX interrupt, read with it disabled
+static const uint8_t (*table)[64] = socd_tables[ADAPTER_SOCD_MODE];
+static Lever_Mode_t lever = ADAPTER_LEVER_MODE;
+static uint8_t lastRaw = 0;
+static uint8_t lastOut = 0;
+
+void socd_set_mode(Socd_Mode_t mode) {
+    if (mode > SOCD_UP_PRIORITY) return;
+    table = socd_tables[mode];
+}
+
+void socd_set_lever(Lever_Mode_t mode) {
+    if (mode > LEVER_RIGHT_STICK) return;
+    lever = mode;
+}
+
+/*
+ * Resolve the direction bits of the next 0x30 report, called once per report.
+ */
+void socd_apply(USB_StandardReport_t *standardReport) {
+    uint8_t *buttons = REPORT_BUTTONS(standardReport);
+    uint8_t raw = buttons[2] & 0x0F;
+
+    disable_rx_isr();
+    uint8_t out = pgm_read_byte(&table[0][(raw & 3) | ((lastRaw & 3) << 2) | ((lastOut & 3) << 4)]);
+    out |= pgm_read_byte(&table[1][(raw >> 2) | (lastRaw & 0x0C) | ((lastOut & 0x0C) << 2)]) << 2;
+    Lever_Mode_t mode = lever;
+    enable_rx_isr();
+    lastRaw = raw;
+    lastOut = out;
+
+    if (mode == LEVER_DPAD) {
+        buttons[2] = (buttons[2] & 0xF0) | out;
+    } else {
+        buttons[2] &= 0xF0;
+        memcpy_P(&standardReport->analog[mode == LEVER_LEFT_STICK ? 0 : 3], lever_sticks[out], 3);
+    }
+}
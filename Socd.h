@@ -0,0 +1,36 @@
+#ifndef SOCD_H
+#define SOCD_H
+
+#include "datatypes.h"
+
+/*
+ * SOCD cleaning and lever mode for the four direction bits (dpad_down/up/right/left in the report).
+ *
+ * SOCD (simultaneous opposing cardinal directions) decides what is reported when both directions of an axis are held:
+ *   SOCD_OFF          both are passed through
+ *   SOCD_NEUTRAL      neither
+ *   SOCD_LAST_INPUT   the one pressed last wins, and the other one comes back when it's released
+ *   SOCD_UP_PRIORITY  up wins over down, left + right is neutral
+ * The lever mode then decides where the cleaned directions go: the D-pad, or full deflection of either stick.
+ *
+ * Each axis is resolved with one flash table lookup indexed by its current bits, its previous bits and its previous
+ * result, so every mode costs the same and there are no branches on the input.
+ */
+typedef enum {
+    SOCD_OFF          = 0,
+    SOCD_NEUTRAL      = 1,
+    SOCD_LAST_INPUT   = 2,
+    SOCD_UP_PRIORITY  = 3,
+} Socd_Mode_t;
+
+typedef enum {
+    LEVER_DPAD        = 0,
+    LEVER_LEFT_STICK  = 1,
+    LEVER_RIGHT_STICK = 2,
+} Lever_Mode_t;
+
+void socd_set_mode(Socd_Mode_t mode);
+void socd_set_lever(Lever_Mode_t mode);
+void socd_apply(USB_StandardReport_t *standardReport);
+
+#endif // SOCD_H
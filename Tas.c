@@ -0,0 +1,88 @@
+#include "Tas.h"
+#include "Response.h"
+
+#ifdef ADAPTER_TAS_QUEUE_SIZE
+
+// Written from the RX interrupt, read with it disabled
+static bool enabled = false;
+static uint8_t queue[ADAPTER_TAS_QUEUE_SIZE][REPORT_INPUT_BYTES];
+static uint8_t queueHead = 0;
+static uint8_t queueCount = 0;
+static uint8_t last[REPORT_INPUT_BYTES];
+static const uint8_t neutral[REPORT_INPUT_BYTES] PROGMEM = {0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80};
+static bool ackPending = false; // A frame was resolved into the report being sent
+static uint8_t ackFlags = 0;
+static uint8_t ackDepth = 0;
+static Tas_Stats_t stats;
+
+/*
+ * Entering or leaving the mode empties the queue and restarts from neutral input.
+ * Called from the RX interrupt.
+ */
+void tas_set_enabled(bool enable) {
+    enabled = enable;
+    queueHead = 0;
+    queueCount = 0;
+    memcpy_P(last, neutral, REPORT_INPUT_BYTES);
+    if (enable) {
+        memset(&stats, 0, sizeof(stats));
+    }
+}
+
+bool tas_enabled(void) {
+    return enabled;
+}
+
+/*
+ * Called from the RX interrupt with a HOSTLINK_TAS_FRAME payload.
+ */
+void tas_push(const uint8_t *frame) {
+    if (!enabled) return;
+    if (queueCount == ADAPTER_TAS_QUEUE_SIZE) {
+        stats.overruns++;
+        return;
+    }
+    memcpy(queue[(queueHead + queueCount) % ADAPTER_TAS_QUEUE_SIZE], frame, REPORT_INPUT_BYTES);
+    queueCount++;
+}
+
+/*
+ * Write the next frame into the 0x30 report, called once per report.
+ */
+void tas_resolve(USB_StandardReport_t *standardReport) {
+    disable_rx_isr();
+    if (queueCount > 0) {
+        memcpy(last, queue[queueHead], REPORT_INPUT_BYTES);
+        queueHead = (queueHead + 1) % ADAPTER_TAS_QUEUE_SIZE;
+        queueCount--;
+        ackFlags = 0;
+    } else {
+        stats.underruns++;
+        ackFlags = TAS_ACK_UNDERRUN;
+    }
+    ackDepth = queueCount;
+    enable_rx_isr();
+    ackPending = true;
+
+    stats.reports++;
+    memcpy(REPORT_BUTTONS(standardReport), last, REPORT_BUTTON_BYTES);
+    memcpy(standardReport->analog, &last[REPORT_BUTTON_BYTES], sizeof(standardReport->analog));
+}
+
+/*
+ * Acknowledge the frame in the 0x30 report that was just sent, 'counter' is its timer byte.
+ */
+void tas_report_sent(uint8_t counter) {
+    if (!ackPending) return; // The first report after 0x80 0x04 is built without input
+    ackPending = false;
+    uint8_t ack[3] = {counter, ackDepth, ackFlags};
+    if (!hostlink_send_frame(HOSTLINK_TAS_ACK, ack, sizeof(ack))) {
+        stats.acks_dropped++;
+    }
+}
+
+const Tas_Stats_t *get_tas_stats(void) {
+    return &stats;
+}
+
+#endif // ADAPTER_TAS_QUEUE_SIZE
@@ -0,0 +1,32 @@
+#ifndef TAS_H
+#define TAS_H
+
+#include "datatypes.h"
+
+/*
+ * Lock-step input for tool-assisted runs, compiled in with ADAPTER_TAS_QUEUE_SIZE.
+ *
+ * The PC enables the mode with HOSTLINK_CONFIG_TAS_MODE and preloads HOSTLINK_TAS_FRAME frames. Every 0x30 report
+ * consumes exactly one queued frame, and the adapter answers with a HOSTLINK_TAS_ACK frame:
+ *   report counter (timer byte of the report), frames left in the queue, TAS_ACK_* flags.
+ * The PC keeps the queue topped up from the acks. If the queue is empty the last frame is repeated (an underrun),
+ * which is counted and flagged in the ack. Frames arriving with the queue full are dropped and counted.
+ */
+#define TAS_ACK_UNDERRUN 0x01 // The report repeated the previous frame
+
+// Acks that didn't fit in the UART queue are lost; the next ack carries the queue depth, so the PC can recover
+typedef struct {
+    uint32_t reports;      // 0x30 reports built in TAS mode
+    uint16_t underruns;
+    uint16_t overruns;     // Frames dropped because the queue was full
+    uint16_t acks_dropped;
+} Tas_Stats_t;
+
+void tas_set_enabled(bool enabled);
+bool tas_enabled(void);
+void tas_push(const uint8_t *frame);
+void tas_resolve(USB_StandardReport_t *standardReport);
+void tas_report_sent(uint8_t counter);
+const Tas_Stats_t *get_tas_stats(void);
+
+#endif // TAS_H
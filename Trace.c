@@ -0,0 +1,80 @@
+#include "Trace.h"
+#include "HostLink.h"
+#include "Clock.h"
+
+#include <string.h>
+
+#ifdef ADAPTER_TRACE
+
+static uint8_t record[TRACE_MAX_RECORD];
+static uint32_t last_stamp = 0;
+static uint16_t dropped = 0;
+static bool dropped_since_last = false;
+
+static uint8_t encode_delta(uint32_t delta, uint8_t *dst) {
+    uint8_t n = 0;
+    while (delta >= 0x80) {
+        dst[n++] = (delta & 0x7F) | 0x80;
+        delta >>= 7;
+    }
+    dst[n++] = delta;
+    return n;
+}
+
+// Runs of 3 or more equal bytes are packed, everything else is copied as literals
+static uint8_t packbits(const uint8_t *src, uint8_t length, uint8_t *dst) {
+    uint8_t in = 0;
+    uint8_t out = 0;
+    while (in < length) {
+        uint8_t run = 1;
+        while (in + run < length && run < 128 && src[in + run] == src[in]) {
+            run++;
+        }
+        if (run >= 3) {
+            dst[out++] = (uint8_t) (257 - run);
+            dst[out++] = src[in];
+            in += run;
+            continue;
+        }
+
+        uint8_t start = in;
+        while (in < length && in - start < 128 &&
+               !(in + 2 < length && src[in] == src[in + 1] && src[in] == src[in + 2])) {
+            in++;
+        }
+        dst[out++] = in - start - 1;
+        memcpy(&dst[out], &src[start], in - start);
+        out += in - start;
+    }
+    return out;
+}
+
+/*
+ * Record a packet. Never blocks: if the UART queue is full the record is dropped and flagged on the next one.
+ */
+void trace_packet(uint8_t flags, const uint8_t *data, uint8_t length) {
+    uint32_t now = clock_now();
+    if (length > TRACE_MAX_PACKET) {
+        length = TRACE_MAX_PACKET;
+    }
+
+    uint8_t n = 0;
+    record[n++] = flags | (dropped_since_last ? TRACE_FLAG_DROPPED : 0);
+    n += encode_delta(now - last_stamp, &record[n]);
+    n += packbits(data, length, &record[n]);
+
+    // The stamp only moves with a sent record, so the delta after a drop still counts from the last record the PC has
+    if (hostlink_send_frame(HOSTLINK_TRACE, record, n)) {
+        last_stamp = now;
+        dropped_since_last = false;
+    } else {
+        dropped_since_last = true;
+        dropped++;
+    }
+}
+
+uint16_t trace_dropped_count(void) {
+    return dropped;
+}
+
+#endif
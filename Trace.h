@@ -0,0 +1,22 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "datatypes.h"
+
+/*
+ * USB traffic trace, streamed to the PC as HOSTLINK_TRACE frames.
+ *
+ * Record payload: flags, ticks since the previous record (LEB128), packet compressed with PackBits.
+ * PackBits control byte n: 0x00-0x7F = n + 1 literal bytes follow, 0x81-0xFF = next byte repeated 257 - n times.
+ */
+#define TRACE_FLAG_IN       0x01 // Packet sent to the console (send_IN_report), otherwise received (process_OUT_report)
+#define TRACE_FLAG_DROPPED  0x02 // At least one record before this one didn't fit in the UART queue
+#define TRACE_FLAG_PLAYER_2 0x04 // Packet of the second controller (ADAPTER_DUAL)
+
+#define TRACE_MAX_PACKET   64
+#define TRACE_MAX_RECORD   (1 + 5 + TRACE_MAX_PACKET + (TRACE_MAX_PACKET + 127) / 128)
+
+void trace_packet(uint8_t flags, const uint8_t *data, uint8_t length);
+uint16_t trace_dropped_count(void);
+
+#endif // TRACE_H
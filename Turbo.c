@@ -0,0 +1,54 @@
+#include "Turbo.h"
+#include "Response.h"
+
+// Written from the RX interrupt, read with it disabled
+static uint8_t mask[REPORT_BUTTON_BYTES];                      // Buttons with turbo
+static uint8_t period[TURBO_PERIOD_BITS][REPORT_BUTTON_BYTES]; // Period - 1, bit-sliced
+static uint8_t count[TURBO_PERIOD_BITS][REPORT_BUTTON_BYTES];  // Reports since the last toggle, bit-sliced
+static uint8_t phase[REPORT_BUTTON_BYTES];                     // Set = held button is shown released
+
+/*
+ * 'button' is the bit index in the report's button bytes (0 = Y ... 23 = ZL), 'period' is in reports, 0 = off.
+ * Called from the RX interrupt.
+ */
+void turbo_set(uint8_t button, uint8_t newPeriod) {
+    if (button >= REPORT_BUTTON_BYTES * 8) return;
+    if (newPeriod > TURBO_MAX_PERIOD) newPeriod = TURBO_MAX_PERIOD;
+
+    uint8_t i = button >> 3;
+    uint8_t bit = 1 << (button & 7);
+    uint8_t stored = newPeriod - 1;
+    for (uint8_t k = 0; k < TURBO_PERIOD_BITS; k++) {
+        period[k][i] = (stored & (1 << k)) ? period[k][i] | bit : period[k][i] & ~bit;
+        count[k][i] &= ~bit;
+    }
+    phase[i] &= ~bit;
+    mask[i] = newPeriod ? mask[i] | bit : mask[i] & ~bit;
+}
+
+/*
+ * Apply turbo to the button bytes of the next 0x30 report, called once per report.
+ */
+void turbo_apply(uint8_t *buttons) {
+    disable_rx_isr();
+    for (uint8_t i = 0; i < REPORT_BUTTON_BYTES; i++) {
+        // Released buttons drop out, so their counter and phase restart on the next press
+        uint8_t active = buttons[i] & mask[i];
+
+        uint8_t wrap = active;
+        for (uint8_t k = 0; k < TURBO_PERIOD_BITS; k++) {
+            wrap &= ~(count[k][i] ^ period[k][i]);
+        }
+
+        uint8_t carry = active;
+        for (uint8_t k = 0; k < TURBO_PERIOD_BITS; k++) {
+            uint8_t c = count[k][i];
+            count[k][i] = (c ^ carry) & active & ~wrap;
+            carry &= c;
+        }
+
+        buttons[i] &= ~phase[i];
+        phase[i] = (phase[i] ^ wrap) & active;
+    }
+    enable_rx_isr();
+}
@@ -0,0 +1,21 @@
+#ifndef TURBO_H
+#define TURBO_H
+
+#include "datatypes.h"
+
+/*
+ * Per-button turbo, stepped once per 0x30 report so the rate is exact: a held turbo button is reported pressed for
+ * 'period' reports, then released for 'period' reports (125 / (2 * period) presses per second at the 8 ms poll).
+ * The first report after a press always shows it.
+ *
+ * Every button has its own frame counter, stored bit-sliced: bit k of every button's counter lives in
+ * count[k], one bit per button in the report's button layout. All counters are compared, incremented and wrapped
+ * together with a few byte operations per plane, so the cost doesn't depend on how many buttons use turbo.
+ */
+#define TURBO_PERIOD_BITS 4
+#define TURBO_MAX_PERIOD  ((1 << TURBO_PERIOD_BITS) - 1)
+
+void turbo_set(uint8_t button, uint8_t period);
+void turbo_apply(uint8_t *buttons);
+
+#endif // TURBO_H
@@ -8,22 +8,213 @@
 
 #include <avr/wdt.h>
 #include <avr/power.h>
+#include <util/atomic.h>
 
 #include <LUFA/Drivers/USB/USB.h>
 #include <LUFA/Drivers/Peripheral/Serial.h>
 #include "Response.h"
+#include "InputLatch.h"
+#include "Tas.h"
+#include "Turbo.h"
+#include "Socd.h"
+#include "Remap.h"
+#include "Mixer.h"
+#include "Record.h"
 
-#define ADAPTER_IN_NUM       (ENDPOINT_DIR_IN | 1)
 #define ADAPTER_IN_SIZE      64
-#define ADAPTER_OUT_NUM      (ENDPOINT_DIR_OUT | 2)
 #define ADAPTER_OUT_SIZE     64
 
+#ifdef ADAPTER_IN_PIPELINE
+#define ADAPTER_IN_BANKS     2
+#else
+#define ADAPTER_IN_BANKS     1
+#endif
+
+#ifdef ADAPTER_STREAM_TIMEOUT_MS
+#define STREAM_TIMEOUT_TICKS CLOCK_US_TO_TICKS(ADAPTER_STREAM_TIMEOUT_MS * 1000UL)
+#else
+#define STREAM_TIMEOUT_TICKS 0 // Never
+#endif
+#define IN_POLL_TICKS        CLOCK_US_TO_TICKS(ADAPTER_IN_POLL_MS * 1000UL)
+#define IN_STAGE_TICKS       (IN_POLL_TICKS - CLOCK_US_TO_TICKS(ADAPTER_IN_STAGE_MARGIN_US))
+
+// Bus events, set from the USB interrupt and handled by connection_task()
+#define USB_EVENT_CONNECT    0x01
+#define USB_EVENT_DISCONNECT 0x02
+#define USB_EVENT_RESET      0x04
+#define USB_EVENT_SUSPEND    0x08
+#define USB_EVENT_WAKEUP     0x10
+#define USB_EVENTS_END_SESSION (USB_EVENT_DISCONNECT | USB_EVENT_RESET | USB_EVENT_SUSPEND)
+
 static bool CALLBACK_beforeSend(void);
 static USB_ExtendedReport_t *selectedReport;
 static USB_ExtendedReport_t r;
 static USB_ExtendedReport_t idleReport;
+#ifdef ADAPTER_DUAL
+// Second controller, its input state is used as sent
+static bool CALLBACK_beforeSend2(void);
+static USB_ExtendedReport_t *selectedReport2;
+static USB_ExtendedReport_t r2;
+static uint8_t input2[REPORT_INPUT_BYTES] = {0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80}; // From the RX ISR
+#endif
+
+// Input stream health, written from the RX interrupt
+static volatile uint32_t lastFrameStamp = 0;
+static volatile uint8_t validFrames = 0; // Since the stream was last declared stalled, saturates at 255
+static bool streamLive = STREAM_TIMEOUT_TICKS == 0; // Without a timeout the stream never stalls, nothing to resync
+static Stream_Stats_t streamStats;
+
+// First input change not yet committed to the IN endpoint, per controller, written from the RX interrupt
+static volatile bool inputPending[JOYSTICK_COUNT];
+static volatile uint32_t inputStamp[JOYSTICK_COUNT];
+
+// IN packets committed to the endpoint banks and not yet taken by the host, oldest first
+typedef struct {
+    bool carries_input;
+    uint32_t input_stamp;
+} In_Packet_t;
+
+static In_Packet_t inFlight[JOYSTICK_COUNT][ADAPTER_IN_BANKS];
+static uint8_t inFlightCount[JOYSTICK_COUNT];
+static uint32_t lastTaken[JOYSTICK_COUNT]; // When the host last took a packet, gives the phase of its polling
+static In_Latency_Stats_t inLatencyStats[JOYSTICK_COUNT];
+
+// USB connection
+static volatile uint8_t usbEvents = 0;
+static volatile uint32_t connectStamp; // VBUS seen, written from the USB interrupt
+static volatile uint32_t sessionStamp; // Last bus reset or resume, written from the USB interrupt
+static volatile bool wakeRequested = false; // Button pressed while suspended, written from the RX interrupt
+static Connection_State_t connectionState = CONNECTION_DETACHED;
+static bool firstReportPending = false;
+static uint32_t vbusStamp;
+static uint32_t firstSessionStamp;
+static Connection_Stats_t connectionStats;
+
+// Stats asked for by the PC, written from the RX interrupt
+static volatile uint8_t statsRequest = 0; // HostLink_Stats_t, 0 = none
+static volatile uint8_t statsArgument;
 
 ISR(USART1_RX_vect) {
+    hostlink_receive_byte(UDR1);
+}
+
+void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+    lastFrameStamp = clock_now();
+    if (validFrames < 0xFF) {
+        validFrames++;
+    }
+
+    switch (type) {
+        case HOSTLINK_INPUT_STATE: {
+            if (length == REPORT_INPUT_BYTES && input_latch_push(payload)) {
+#ifdef ADAPTER_MIXER
+                mixer_host_changed();
+#endif
+                if (!inputPending[0]) {
+                    inputStamp[0] = lastFrameStamp;
+                    inputPending[0] = true;
+                }
+            }
+            if (length == REPORT_INPUT_BYTES && connectionState == CONNECTION_SUSPENDED &&
+                (payload[0] | payload[1] | payload[2]) != 0) {
+                wakeRequested = true;
+            }
+            break;
+        }
+#ifdef ADAPTER_DUAL
+        case HOSTLINK_INPUT_STATE | HOSTLINK_PLAYER_2: {
+            if (length != REPORT_INPUT_BYTES) {
+                break;
+            }
+            if (memcmp(input2, payload, REPORT_INPUT_BYTES) != 0 && !inputPending[1]) {
+                inputStamp[1] = lastFrameStamp;
+                inputPending[1] = true;
+            }
+            memcpy(input2, payload, REPORT_INPUT_BYTES);
+            if (connectionState == CONNECTION_SUSPENDED && (payload[0] | payload[1] | payload[2]) != 0) {
+                wakeRequested = true;
+            }
+            break;
+        }
+#endif
+        case HOSTLINK_CONFIG: {
+            if (length == 2 && payload[0] == HOSTLINK_CONFIG_LATCH_POLICY && payload[1] <= LATCH_QUEUE) {
+                input_latch_set_policy(payload[1]);
+            }
+            if (length == 2 && payload[0] == HOSTLINK_CONFIG_SOCD_MODE) {
+                socd_set_mode(payload[1]);
+            }
+            if (length == 2 && payload[0] == HOSTLINK_CONFIG_LEVER_MODE) {
+                socd_set_lever(payload[1]);
+            }
+#ifdef ADAPTER_REMAP_LAYERS
+            if (length == 2 && payload[0] == HOSTLINK_CONFIG_REMAP_LAYER) {
+                remap_select_layer(payload[1]);
+            }
+#endif
+#ifdef ADAPTER_RECORD_EEPROM_SIZE
+            if (length == 2 && payload[0] == HOSTLINK_CONFIG_RECORD_MODE) {
+                record_set_mode(payload[1]);
+            }
+#endif
+#ifdef ADAPTER_TAS_QUEUE_SIZE
+            if (length == 2 && payload[0] == HOSTLINK_CONFIG_TAS_MODE) {
+                tas_set_enabled(payload[1] != 0);
+            }
+#endif
+            break;
+        }
+#ifdef ADAPTER_MIXER
+        case HOSTLINK_SOURCE_STATE: {
+            if (length == 1 + REPORT_INPUT_BYTES && mixer_submit(payload[0], &payload[1]) && !inputPending[0]) {
+                inputStamp[0] = lastFrameStamp;
+                inputPending[0] = true;
+            }
+            break;
+        }
+        case HOSTLINK_MIXER: {
+            if (length == 4) {
+                mixer_configure(payload[0], payload[1], payload[2] | (payload[3] << 8));
+            }
+            break;
+        }
+#endif
+#ifdef ADAPTER_RECORD_EEPROM_SIZE
+        case HOSTLINK_RECORD_LOAD: {
+            record_load(payload, length);
+            break;
+        }
+#endif
+#ifdef ADAPTER_REMAP_LAYERS
+        case HOSTLINK_REMAP: {
+            if (length == 3) {
+                remap_set(payload[0], payload[1], payload[2]);
+            }
+            break;
+        }
+#endif
+        case HOSTLINK_STATS_REQUEST: {
+            if (length == 2) {
+                statsArgument = payload[1];
+                statsRequest = payload[0];
+            }
+            break;
+        }
+        case HOSTLINK_TURBO: {
+            if (length == 2) {
+                turbo_set(payload[0], payload[1]);
+            }
+            break;
+        }
+#ifdef ADAPTER_TAS_QUEUE_SIZE
+        case HOSTLINK_TAS_FRAME: {
+            if (length == REPORT_INPUT_BYTES) {
+                tas_push(payload);
+            }
+            break;
+        }
+#endif
+    }
 }
 
 void SetupHardware(void) {
@@ -33,9 +224,9 @@ void SetupHardware(void) {
 
     clock_prescale_set(clock_div_1);
 
-    TCCR1B |= (1 << CS12); // Set up timer at FCPU / 256
+    clock_init(); // Set up timer at FCPU / 256
 
-    Serial_Init(9600, false);
+    Serial_Init(ADAPTER_UART_BAUD, ADAPTER_UART_DOUBLE_SPEED);
 
     UCSR1B |= (1 << RXCIE1); // Enable the USART Receive Complete interrupt (USART_RXC)
 
@@ -64,17 +255,41 @@ void EVENT_USB_Device_ControlRequest(void) {
 }
 
 void EVENT_USB_Device_Connect(void) {
+    connectStamp = sessionStamp = clock_now();
+    usbEvents |= USB_EVENT_CONNECT;
+    LOG(LOG_USB_CONNECT);
 }
 
 void EVENT_USB_Device_Disconnect(void) {
+    usbEvents |= USB_EVENT_DISCONNECT;
+    LOG(LOG_USB_DISCONNECT);
+}
+
+void EVENT_USB_Device_Reset(void) {
+    sessionStamp = clock_now();
+    usbEvents |= USB_EVENT_RESET;
+    LOG(LOG_USB_RESET);
+}
+
+void EVENT_USB_Device_Suspend(void) {
+    usbEvents |= USB_EVENT_SUSPEND;
+    LOG(LOG_USB_SUSPEND);
+}
+
+void EVENT_USB_Device_WakeUp(void) {
+    sessionStamp = clock_now();
+    usbEvents |= USB_EVENT_WAKEUP;
+    LOG(LOG_USB_WAKEUP);
 }
 
 void EVENT_USB_Device_ConfigurationChanged(void) {
 
-    Endpoint_ConfigureEndpoint(ADAPTER_IN_NUM, EP_TYPE_INTERRUPT, ADAPTER_IN_SIZE, 1);
-#ifdef ADAPTER_OUT_NUM
-    Endpoint_ConfigureEndpoint(ADAPTER_OUT_NUM, EP_TYPE_INTERRUPT, ADAPTER_OUT_SIZE, 1);
-#endif
+    // In ascending endpoint order, the endpoint memory is allocated in that order
+    for (uint8_t player = 0; player < JOYSTICK_COUNT; player++) {
+        Endpoint_ConfigureEndpoint(JOYSTICK_PLAYER_IN_EPADDR(player), EP_TYPE_INTERRUPT, ADAPTER_IN_SIZE, ADAPTER_IN_BANKS);
+        inFlightCount[player] = 0;
+        Endpoint_ConfigureEndpoint(JOYSTICK_PLAYER_OUT_EPADDR(player), EP_TYPE_INTERRUPT, ADAPTER_OUT_SIZE, 1);
+    }
 }
 
 static void initialize_idle_report(USB_ExtendedReport_t *extendedReport) {
@@ -127,10 +342,241 @@ static void initialize_idle_report(USB_ExtendedReport_t *extendedReport) {
     standardReport->vibrator_input_report = 0x0c;
 }
 
+/*
+ * Switch to the neutral idle report when the PC stops sending, and back once frames flow again. With ADAPTER_MIXER
+ * the report stays selected for the other sources and only the PC's share is released.
+ * Runs from the main loop; selectedReport is only read from the main loop too, so the switch is atomic with
+ * respect to report building.
+ */
+static void stream_health_task(void) {
+    disable_rx_isr();
+    uint32_t last = lastFrameStamp;
+    uint8_t frames = validFrames;
+    enable_rx_isr();
+
+#ifdef ADAPTER_DUAL
+    // Only the stream matters for the second controller, it follows the state left by the previous call
+    selectedReport2 = streamLive ? &r2 : &idleReport;
+#endif
+
+#ifdef ADAPTER_TAS_QUEUE_SIZE
+    if (tas_enabled()) {
+        selectedReport = &r; // Underruns repeat the last frame instead
+        return;
+    }
+#endif
+#ifdef ADAPTER_RECORD_EEPROM_SIZE
+    if (record_mode() == RECORD_REPLAYING) {
+        selectedReport = &r; // Playback doesn't need the PC
+        return;
+    }
+#endif
+    if (streamLive) {
+        if (STREAM_TIMEOUT_TICKS != 0 && clock_now() - last > STREAM_TIMEOUT_TICKS) {
+            streamLive = false;
+            input_latch_reset();
+            disable_rx_isr();
+            validFrames = 0;
+            enable_rx_isr();
+            streamStats.stalls++;
+        }
+    } else if (frames >= ADAPTER_STREAM_RESYNC_FRAMES) {
+        streamLive = true;
+        streamStats.resyncs++;
+    }
+#ifdef ADAPTER_MIXER
+    selectedReport = &r; // The other sources keep driving the report, the latch reset released the PC's share
+#else
+    selectedReport = streamLive ? &r : &idleReport; // Release everything while the stream is down
+#endif
+}
+
+/*
+ * Follow the bus state, which LUFA reports from the USB interrupt. Runs first in the main loop, so a reset, suspend
+ * or disconnect has cleared the console session (see reset_response_manager) before any packet of the next session
+ * is handled. While suspended, a button press signals a remote wakeup, as advertised in the configuration descriptor,
+ * once the host has enabled it.
+ */
+static void connection_task(void) {
+    uint8_t events;
+    uint32_t connected;
+    uint32_t session;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        events = usbEvents;
+        usbEvents = 0;
+        connected = connectStamp;
+        session = sessionStamp;
+    }
+
+    if (events & USB_EVENTS_END_SESSION) {
+        for (uint8_t player = 0; player < JOYSTICK_COUNT; player++) {
+            response_select(player);
+            reset_response_manager();
+            inFlightCount[player] = 0;
+        }
+        response_select(0);
+    }
+    if (events & USB_EVENT_CONNECT) {
+        connectionStats.connects++;
+        vbusStamp = connected;
+        firstReportPending = true;
+    }
+    if (events & USB_EVENT_RESET) connectionStats.bus_resets++;
+    if (events & USB_EVENT_SUSPEND) connectionStats.suspends++;
+    if (events & (USB_EVENT_CONNECT | USB_EVENT_RESET | USB_EVENT_WAKEUP)) {
+        firstSessionStamp = session;
+    }
+
+    Connection_State_t state;
+    switch (USB_DeviceState) {
+        case DEVICE_STATE_Unattached: state = CONNECTION_DETACHED; break;
+        case DEVICE_STATE_Suspended:  state = CONNECTION_SUSPENDED; break;
+        case DEVICE_STATE_Configured: {
+            bool streaming = connectionState == CONNECTION_STREAMING && !(events & USB_EVENTS_END_SESSION);
+            state = streaming ? CONNECTION_STREAMING : CONNECTION_CONFIGURED;
+            break;
+        }
+        default:                      state = CONNECTION_ATTACHED; break;
+    }
+    connectionState = state;
+
+    if (state != CONNECTION_SUSPENDED) {
+        wakeRequested = false; // Presses from before the suspend don't count
+    } else if (wakeRequested) {
+        wakeRequested = false;
+        if (USB_Device_RemoteWakeupEnabled) {
+            USB_Device_SendRemoteWakeup();
+            connectionStats.remote_wakeups++;
+            LOG(LOG_REMOTE_WAKEUP);
+        }
+    }
+}
+
+// Input reports in any of the SET_INPUT_REPORT_MODE formats
+static bool is_input_report(uint8_t reportId) {
+    return reportId == 0x30 || reportId == 0x31 || reportId == 0x3F;
+}
+
+// The first input report completes the handshake, record how long it took
+static void connection_report_sent(uint8_t reportId) {
+    if (!is_input_report(reportId) || connectionState != CONNECTION_CONFIGURED) {
+        return;
+    }
+    connectionState = CONNECTION_STREAMING;
+    uint32_t now = clock_now();
+    connectionStats.session_ticks = now - firstSessionStamp;
+    if (firstReportPending) {
+        firstReportPending = false;
+        connectionStats.connect_ticks = now - vbusStamp;
+    }
+#ifdef ADAPTER_LOG
+    uint16_t connectMs = connectionStats.connect_ticks / CLOCK_US_TO_TICKS(1000);
+    uint16_t sessionMs = connectionStats.session_ticks / CLOCK_US_TO_TICKS(1000);
+    LOG(LOG_FIRST_REPORT, connectMs, connectMs >> 8, sessionMs, sessionMs >> 8);
+#endif
+}
+
+// Copy a stats struct into a HOSTLINK_STATS payload, returns its size
+static uint8_t copy_stats(uint8_t *out, const void *stats, uint8_t size) {
+    memcpy(out, stats, size);
+    return size;
+}
+
+/*
+ * Answer a HOSTLINK_STATS_REQUEST once the UART queue has room for it. The stats are copied with the RX interrupt
+ * disabled, some of them are updated from it.
+ */
+static void stats_task(void) {
+    uint8_t payload[2 + 16];
+    uint8_t n = 2;
+    disable_rx_isr();
+    payload[0] = statsRequest;
+    payload[1] = statsArgument;
+    switch (payload[0]) {
+        case 0:
+            enable_rx_isr();
+            return;
+#ifdef ADAPTER_SUBCOMMAND_STATS
+        case HOSTLINK_STATS_SUBCOMMANDS: {
+            for (uint8_t i = 0; i < 8; i++) {
+                uint16_t hits = subcommand_hit_count(payload[1] + i);
+                payload[n++] = hits & 0xFF;
+                payload[n++] = hits >> 8;
+            }
+            break;
+        }
+#endif
+#ifdef ADAPTER_REPORT_PACING_MS
+        case HOSTLINK_STATS_PACING: {
+            if (payload[1] < JOYSTICK_COUNT) {
+                response_select(payload[1]);
+                n += copy_stats(&payload[n], get_pacing_stats(), sizeof(Pacing_Stats_t));
+                response_select(0);
+            }
+            break;
+        }
+#endif
+        case HOSTLINK_STATS_LATCH:
+            n += copy_stats(&payload[n], get_latch_stats(), sizeof(Latch_Stats_t));
+            break;
+        case HOSTLINK_STATS_STREAM:
+            n += copy_stats(&payload[n], &streamStats, sizeof(Stream_Stats_t));
+            break;
+        case HOSTLINK_STATS_IN_LATENCY: {
+            if (payload[1] < JOYSTICK_COUNT) {
+                n += copy_stats(&payload[n], &inLatencyStats[payload[1]], sizeof(In_Latency_Stats_t));
+            }
+            break;
+        }
+        case HOSTLINK_STATS_INTERFACE: {
+            if (payload[1] < JOYSTICK_COUNT) {
+                response_select(payload[1]);
+                n += copy_stats(&payload[n], get_interface_stats(), sizeof(Interface_Stats_t));
+                response_select(0);
+            }
+            break;
+        }
+    }
+    enable_rx_isr();
+
+    if (hostlink_send_frame(HOSTLINK_STATS, payload, n)) {
+        disable_rx_isr();
+        if (statsRequest == payload[0] && statsArgument == payload[1]) {
+            statsRequest = 0; // Unless a new request came in meanwhile
+        }
+        enable_rx_isr();
+    }
+}
+
 static bool CALLBACK_beforeSend() {
     //if (sendReport)
     //{
-        selectedReport = &r;
+#ifdef ADAPTER_TAS_QUEUE_SIZE
+        if (tas_enabled()) {
+            tas_resolve(&r.standardReport);
+            return true;
+        }
+#endif
+#ifdef ADAPTER_RECORD_EEPROM_SIZE
+        if (record_mode() == RECORD_REPLAYING) {
+            record_replay(&r.standardReport);
+            return true;
+        }
+#endif
+        if (selectedReport == &r) {
+            input_latch_resolve(&r.standardReport);
+#ifdef ADAPTER_MIXER
+            mixer_resolve(&r.standardReport);
+#endif
+#ifdef ADAPTER_REMAP_LAYERS
+            remap_apply(REPORT_BUTTONS(&r.standardReport));
+#endif
+            socd_apply(&r.standardReport);
+            turbo_apply(REPORT_BUTTONS(&r.standardReport));
+        }
+#ifdef ADAPTER_RECORD_EEPROM_SIZE
+        record_sample(REPORT_BUTTONS(&selectedReport->standardReport));
+#endif
         //selectedReport = &idleReport;
         //sendReport = 0;
         return true;
@@ -141,20 +587,98 @@ static bool CALLBACK_beforeSend() {
     //}
 }
 
-void SendNextReport(void) {
+#ifdef ADAPTER_DUAL
+static bool CALLBACK_beforeSend2(void) {
+    if (selectedReport2 == &r2) {
+        disable_rx_isr();
+        memcpy(REPORT_BUTTONS(&r2.standardReport), input2, REPORT_INPUT_BYTES);
+        enable_rx_isr();
+    }
+    return true;
+}
+#endif
+
+/*
+ * Retire the packets the host has taken since the previous call, and record how long the input they carried
+ * waited. Called with the player's IN endpoint selected.
+ */
+static void track_IN_banks(uint8_t player) {
+#ifdef ADAPTER_IN_PIPELINE
+    uint8_t busy = UESTA0X & ((1 << NBUSYBK1) | (1 << NBUSYBK0));
+#else
+    uint8_t busy = Endpoint_IsINReady() ? 0 : 1;
+#endif
+    In_Packet_t *packets = inFlight[player];
+    while (inFlightCount[player] > busy) {
+        uint32_t now = clock_now();
+        lastTaken[player] = now;
+        if (packets[0].carries_input) {
+            uint32_t latency = now - packets[0].input_stamp;
+            if (latency > 0xFFFF) latency = 0xFFFF;
+            In_Latency_Stats_t *stats = &inLatencyStats[player];
+            stats->samples++;
+            stats->total += latency;
+            if (latency > stats->max) {
+                stats->max = latency;
+            }
+        }
+        inFlightCount[player]--;
+        memmove(&packets[0], &packets[1], inFlightCount[player] * sizeof(In_Packet_t));
+    }
+}
+
+/*
+ * With ADAPTER_IN_PIPELINE, decide whether to commit a packet now instead of waiting for a free bank.
+ * A committed bank can't be taken back, so at most one 0x30 report is in flight: a second one would sit behind the
+ * first and add a poll of latency to whatever arrives next. The second bank is kept for replies to the console.
+ */
+static bool IN_commit_due(uint8_t player) {
+#ifdef ADAPTER_IN_PIPELINE
+    if (inFlightCount[player] >= ADAPTER_IN_BANKS) return false;
+    if (reply_pending()) return true;
+    if (inFlightCount[player] > 0) return false;
+    if (inputPending[player]) return true; // New input goes out with the very next IN token
+    return clock_now() - lastTaken[player] >= IN_STAGE_TICKS; // Nothing changed, commit as late as possible
+#else
+    // Received IN interrupt. Switch wants a new packet.
+    return Endpoint_IsINReady();
+#endif
+}
+
+void SendNextReport(uint8_t player) {
 
     // We'll then move on to the IN endpoint.
-    Endpoint_SelectEndpoint(JOYSTICK_IN_EPADDR);
-    // We first check to see if the host is ready to accept data.
-    if (Endpoint_IsINReady()) {
-        // Received IN interrupt. Switch wants a new packet.
-        send_IN_report();
+    Endpoint_SelectEndpoint(JOYSTICK_PLAYER_IN_EPADDR(player));
+    track_IN_banks(player);
+    // We first check to see if there's a bank free for the next packet.
+    if (IN_commit_due(player)) {
+        uint8_t reportId = send_IN_report();
+
+        disable_rx_isr();
+        bool carries = inputPending[player] && reportId != 0x21 && reportId != 0x81; // Replies don't resolve new input
+        uint32_t stamp = inputStamp[player];
+        if (reportId == 0 || carries) {
+            inputPending[player] = false; // Nothing to send it in before the console starts 0x30 reports
+        }
+        enable_rx_isr();
+
+#ifdef ADAPTER_TAS_QUEUE_SIZE
+        if (player == 0 && is_input_report(reportId) && tas_enabled()) {
+            tas_report_sent(get_report_counter());
+        }
+#endif
+        connection_report_sent(reportId);
+        if (reportId != 0) {
+            In_Packet_t *packet = &inFlight[player][inFlightCount[player]++];
+            packet->carries_input = carries;
+            packet->input_stamp = stamp;
+        }
     }
 }
 
-void ReceiveNextReport(void) {
+void ReceiveNextReport(uint8_t player) {
     // We'll start with the OUT endpoint.
-    Endpoint_SelectEndpoint(JOYSTICK_OUT_EPADDR);
+    Endpoint_SelectEndpoint(JOYSTICK_PLAYER_OUT_EPADDR(player));
     // We'll check to see if we received something on the OUT endpoint.
     if (Endpoint_IsOUTReceived()) {
         // Messages from Switch
@@ -179,10 +703,7 @@ void ReceiveNextReport(void) {
         Endpoint_ClearOUT();
 
         // At this point, we can react to this data.
-        //for (uint8_t i = 0; i < ReportSize; i++) {
-        //    Serial_SendString(switchResponseBuffer[i]);
-        //}
-        //Serial_SendString("\r\n");
+        LOG_REPORT(LOG_OUT_REPORT, switchResponseBuffer[0], ReportSize, switchResponseBuffer[10]);
         process_OUT_report(switchResponseBuffer, ReportSize);
     }
 }
@@ -192,9 +713,14 @@ void HID_Task(void) {
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    ReceiveNextReport();
+    // Each controller has its own endpoints and protocol state, the other tasks expect the first one selected
+    for (uint8_t player = JOYSTICK_COUNT; player-- > 0;) {
+        response_select(player);
+
+        ReceiveNextReport(player);
 
-    SendNextReport();
+        SendNextReport(player);
+    }
 }
 
 int main(void) {
@@ -203,11 +729,37 @@ int main(void) {
     // Assign default controller state values (no buttons pressed and centered sticks)
     //initialize_idle_report(&controllerReport); // Will be populated later with values received from UART
     initialize_idle_report(&idleReport); // Idle report (no buttons pressed)
+    initialize_idle_report(&r); // Buttons and sticks are filled in by the input latch
     selectedReport = &idleReport; // Use idle report until data is received from UART
 
+#ifdef ADAPTER_REMAP_LAYERS
+    remap_init();
+#endif
+
+#ifdef ADAPTER_DUAL
+    initialize_idle_report(&r2);
+    selectedReport2 = &idleReport;
+    response_select(1);
+    setup_response_manager(CALLBACK_beforeSend2, &selectedReport2);
+    response_select(0);
+#endif
     setup_response_manager(CALLBACK_beforeSend, &selectedReport);
     for(;;) {
+        connection_task();
         HID_Task();
         USB_USBTask();
+        stream_health_task();
+        console_events_task();
+        stats_task();
+        hostlink_tx_task();
+#ifdef ADAPTER_LOG
+        log_task();
+#endif
+#ifdef ADAPTER_REMAP_LAYERS
+        remap_task();
+#endif
+#ifdef ADAPTER_RECORD_EEPROM_SIZE
+        record_task();
+#endif
     }
 }
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "AdapterConfig.h"
+
 // Type Defines
 // Enumeration for joystick buttons.
 typedef enum {
@@ -75,6 +77,65 @@ typedef enum {
     SUBCOMMAND_GET_REGULATED_VOLTAGE        = 0x50,
 } Switch_Subcommand_t;
 
+// Subcommand ids are looked up directly, so every id up to the last one above needs a table slot
+#define SUBCOMMAND_TABLE_SIZE (SUBCOMMAND_GET_REGULATED_VOLTAGE + 1)
+
+// State requested by the console through subcommands
+typedef struct {
+    uint8_t player_lights; // SET_PLAYER_LIGHTS argument: low nibble on, high nibble flashing
+    uint8_t home_light;    // SET_HOME_LIGHTS start intensity (0x0-0xF)
+    uint8_t report_mode;   // SET_INPUT_REPORT_MODE argument (0x30 full, 0x31 NFC/IR, 0x3F simple HID)
+    bool imu_enable;
+    bool vibration_enable;
+} Console_State_t;
+
+// Report pacing statistics, in clock ticks
+typedef struct {
+    uint16_t reports;    // Paced reports sent
+    uint16_t missed;     // Periods skipped entirely (schedule restarted)
+    uint16_t late_max;   // Worst lateness against the schedule
+    uint32_t late_total; // Sum of lateness, divide by 'reports' for the average
+} Pacing_Stats_t;
+
+// USB traffic of one controller interface
+typedef struct {
+    uint32_t in_packets;  // IN packets written to the endpoint (replies and input reports)
+    uint32_t in_bytes;
+    uint32_t out_packets; // OUT packets from the console
+    uint32_t out_bytes;
+} Interface_Stats_t;
+
+// UART input stream health
+typedef struct {
+    uint16_t stalls;  // Times the stream timed out and the idle report was selected
+    uint16_t resyncs; // Times the stream came back (including the first start)
+} Stream_Stats_t;
+
+// Time from a change of the input state to the host taking the IN packet that carries it, in clock ticks
+typedef struct {
+    uint16_t samples;
+    uint16_t max;
+    uint32_t total;
+} In_Latency_Stats_t;
+
+// USB connection, see connection_task() in adapter_switch.c
+typedef enum {
+    CONNECTION_DETACHED,   // No VBUS
+    CONNECTION_ATTACHED,   // VBUS present, not configured by the host yet
+    CONNECTION_CONFIGURED, // Configured, handshake with the console in progress
+    CONNECTION_STREAMING,  // 0x30 reports are being sent
+    CONNECTION_SUSPENDED,  // Bus suspended, a button press sends a remote wakeup if the host allowed it
+} Connection_State_t;
+
+typedef struct {
+    uint16_t connects;       // VBUS appeared
+    uint16_t bus_resets;
+    uint16_t suspends;
+    uint16_t remote_wakeups; // Remote wakeups signalled after a button press
+    uint32_t connect_ticks;  // VBUS to the first 0x30 report of the last connection
+    uint32_t session_ticks;  // Last bus reset or resume to the first 0x30 report after it
+} Connection_Stats_t;
+
 // https://github.com/dekuNukem/Nintendo_Switch_Reverse_Engineering/blob/master/spi_flash_notes.md
 typedef enum {
     ADDRESS_SERIAL_NUMBER         = 0x6000,
@@ -122,8 +183,15 @@ typedef struct {
     uint8_t vibrator_input_report;
 } USB_StandardReport_t;
 
+// Raw access to the button bytes of USB_StandardReport_t, in report order:
+// [0] Y X B A SR SL R ZR, [1] - + RS LS HOME CAPTURE (dummy) GRIP, [2] DOWN UP RIGHT LEFT SR SL L ZL (LSB first)
+#define REPORT_BUTTONS(standardReport) (((uint8_t *) (standardReport)) + 1)
+#define REPORT_BUTTON_BYTES 3
+#define REPORT_INPUT_BYTES  (REPORT_BUTTON_BYTES + 6) // Buttons and analog, as sent in HOSTLINK_INPUT_STATE
+
 // Full (extended) input report sent to Switch, with IMU data
-typedef struct {
+// Packed so the host build (tools/hostbuild) lays it out like the AVR does, with the IMU data right after byte 11
+typedef struct __attribute__((packed)) {
     USB_StandardReport_t standardReport;
     int16_t imu[3 * 2 * 3]; // each axis is uint16_t, 3 axis per sensor, 2 sensors (accel and gyro), 3 reports
 } USB_ExtendedReport_t;
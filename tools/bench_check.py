@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+Check "bench <name> <cycles>" lines printed by the benchmark firmware (Bench.c) against a budget file.
+
+Usage: simavr adapter_bench.elf 2>&1 | python3 tools/bench_check.py tools/bench_budget.txt
+Exits with 1 if any result is over budget, has no budget, or the benchmark didn't finish. Results checked against an
+estimated budget (~cycles) are marked as such and listed at the end, they pass but haven't been checked against a
+measurement.
+"""
+import fnmatch
+import re
+import sys
+
+F_CPU = 16000000
+
+
+def load_budgets(path):
+    budgets = []
+    with open(path) as f:
+        for line in f:
+            line = line.split('#', 1)[0].strip()
+            if line:
+                pattern, cycles = line.split()
+                budgets.append((pattern, int(cycles.lstrip('~')), cycles.startswith('~')))
+    return budgets
+
+
+def find_budget(budgets, name):
+    for pattern, cycles, estimated in budgets:
+        if fnmatch.fnmatchcase(name, pattern):
+            return cycles, estimated
+    return None, False
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__.strip())
+    budgets = load_budgets(sys.argv[1])
+
+    failed = False
+    done = False
+    results = 0
+    estimated_results = 0
+    for line in sys.stdin:
+        m = re.search(r'bench (\S+)(?: (\d+))?', line)
+        if not m:
+            continue
+        name = m.group(1)
+        if name == 'done':
+            done = True
+            continue
+        cycles = int(m.group(2))
+        budget, estimated = find_budget(budgets, name)
+        results += 1
+
+        if budget is None:
+            status = 'NO BUDGET'
+            failed = True
+        elif cycles > budget:
+            status = 'OVER'
+            failed = True
+        elif estimated:
+            status = 'estimate'
+            estimated_results += 1
+        else:
+            status = 'ok'
+        budget_text = '-' if budget is None else ('~%d' % budget if estimated else str(budget))
+        print('%-34s %7d cycles %8.1f us  budget %6s  %s' % (name, cycles, cycles * 1e6 / F_CPU, budget_text, status))
+
+    if estimated_results:
+        print('%d of %d results only checked against estimated budgets, measure them and update %s'
+              % (estimated_results, results, sys.argv[1]))
+    if not done:
+        print('benchmark did not finish (%d results)' % results)
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
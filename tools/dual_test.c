@@ -0,0 +1,157 @@
+/*
+ * Two controllers of an ADAPTER_DUAL build driven at the same time, run by "make -C tools test".
+ *
+ * Handshakes, subcommands and input reports alternate between the two protocol contexts step by step, the way two
+ * consoles (or one console with two controllers) would interleave them. Each context has to keep its own session:
+ * MAC address, console state, report mode, input report and traffic counters.
+ */
+#include <string.h>
+
+#include "host.h"
+#include "Response.h"
+#include "test_console.h"
+
+#if JOYSTICK_COUNT != 2
+#error dual_test needs ADAPTER_DUAL
+#endif
+
+// mac_address in Response.c, the second controller adds 1 to the first byte
+#define MAC_FIRST_BYTE 0xD4
+// Offset of the subcommand data in a 0x21 reply: id, timer, standard report, ack, subcommand
+#define REPLY_DATA (2 + sizeof(USB_StandardReport_t) + 2)
+
+static USB_ExtendedReport_t reports[JOYSTICK_COUNT];
+static USB_ExtendedReport_t *selectedReports[JOYSTICK_COUNT] = {&reports[0], &reports[1]};
+static uint32_t outPackets[JOYSTICK_COUNT]; // Sent by the test, per controller
+
+static bool before_send(void) {
+    return true;
+}
+
+// No UART input in this test
+void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+}
+
+static const uint8_t *command(uint8_t player, uint8_t command) {
+    response_select(player);
+    outPackets[player]++;
+    const uint8_t *reply = console_command(command);
+    CHECK(reply == NULL || host_in_endpoint == JOYSTICK_PLAYER_IN_EPADDR(player));
+    return reply;
+}
+
+static const uint8_t *subcommand(uint8_t player, uint8_t id, uint8_t argument) {
+    response_select(player);
+    outPackets[player]++;
+    const uint8_t *reply = console_subcommand(id, &argument, 1);
+    CHECK(reply != NULL && host_in_endpoint == JOYSTICK_PLAYER_IN_EPADDR(player));
+    return reply;
+}
+
+static void test_handshake(void) {
+    for (uint8_t player = 0; player < JOYSTICK_COUNT; player++) {
+        const uint8_t *reply = command(player, 0x01);
+        CHECK(reply != NULL && reply[0] == 0x81 && reply[1] == 0x01);
+        CHECK(reply != NULL && reply[4] == MAC_FIRST_BYTE + player);
+    }
+    const uint8_t steps[] = {0x02, 0x03, 0x02};
+    for (uint8_t i = 0; i < sizeof(steps); i++) {
+        for (uint8_t player = 0; player < JOYSTICK_COUNT; player++) {
+            const uint8_t *reply = command(player, steps[i]);
+            CHECK(reply != NULL && reply[0] == 0x81 && reply[1] == steps[i]);
+        }
+    }
+    // Only the second controller starts reports for now, the first one must stay quiet
+    CHECK(command(1, 0x04) != NULL);
+    response_select(0);
+    CHECK(console_poll() == NULL);
+    CHECK(command(0, 0x04) != NULL);
+}
+
+static void test_subcommands(void) {
+    for (uint8_t player = 0; player < JOYSTICK_COUNT; player++) {
+        const uint8_t *reply = subcommand(player, SUBCOMMAND_REQUEST_DEVICE_INFO, 0);
+        // The MAC address is sent big-endian, its first byte comes last
+        CHECK(reply != NULL && reply[REPLY_DATA + 9] == MAC_FIRST_BYTE + player);
+    }
+    subcommand(0, SUBCOMMAND_SET_PLAYER_LIGHTS, 0x01);
+    subcommand(1, SUBCOMMAND_SET_PLAYER_LIGHTS, 0x02);
+    subcommand(1, SUBCOMMAND_SET_INPUT_REPORT_MODE, 0x3F);
+    subcommand(0, SUBCOMMAND_ENABLE_IMU, 1);
+
+    response_select(0);
+    CHECK(get_console_state()->player_lights == 0x01);
+    CHECK(get_console_state()->report_mode == 0x30);
+    CHECK(get_console_state()->imu_enable);
+    response_select(1);
+    CHECK(get_console_state()->player_lights == 0x02);
+    CHECK(get_console_state()->report_mode == 0x3F);
+    CHECK(!get_console_state()->imu_enable);
+
+    // The player lights reply of each controller is its own
+    const uint8_t *reply = subcommand(0, SUBCOMMAND_GET_PLAYER_LIGHTS, 0);
+    CHECK(reply != NULL && reply[REPLY_DATA] == 0x01);
+    reply = subcommand(1, SUBCOMMAND_GET_PLAYER_LIGHTS, 0);
+    CHECK(reply != NULL && reply[REPLY_DATA] == 0x02);
+}
+
+static void test_reports(void) {
+    REPORT_BUTTONS(&reports[0].standardReport)[0] = 0x08; // A
+    REPORT_BUTTONS(&reports[1].standardReport)[0] = 0x04; // B
+    for (uint8_t i = 0; i < 4; i++) {
+        response_select(0);
+        const uint8_t *packet = console_poll();
+        CHECK(packet != NULL && packet[0] == 0x30 && packet[3] == 0x08);
+        CHECK(console_poll_length() == JOYSTICK_EPSIZE);
+        CHECK(host_in_endpoint == JOYSTICK_PLAYER_IN_EPADDR(0));
+
+        response_select(1);
+        packet = console_poll();
+        if (i == 0) {
+            CHECK(packet != NULL && packet[0] == 0x3F && packet[1] == 0x01); // B
+            CHECK(console_poll_length() == 12);
+            CHECK(host_in_endpoint == JOYSTICK_PLAYER_IN_EPADDR(1));
+        } else {
+            CHECK(packet == NULL); // Unchanged 0x3F, whatever the first controller sends
+        }
+    }
+}
+
+// A bus reset of one controller leaves the other one's session alone
+static void test_reset(void) {
+    response_select(1);
+    reset_response_manager();
+    CHECK(get_console_state()->player_lights == 0);
+    CHECK(get_console_state()->report_mode == 0x30);
+
+    response_select(0);
+    CHECK(get_console_state()->player_lights == 0x01);
+    CHECK(get_console_state()->imu_enable);
+    const uint8_t *packet = console_poll();
+    CHECK(packet != NULL && packet[0] == 0x30);
+
+    const uint8_t *reply = command(1, 0x01);
+    CHECK(reply != NULL && reply[0] == 0x81 && reply[4] == MAC_FIRST_BYTE + 1);
+}
+
+static void test_interface_stats(void) {
+    for (uint8_t player = 0; player < JOYSTICK_COUNT; player++) {
+        response_select(player);
+        CHECK(get_interface_stats()->out_packets == outPackets[player]);
+    }
+}
+
+int main(void) {
+    for (uint8_t player = JOYSTICK_COUNT; player-- > 0;) {
+        response_select(player);
+        reports[player].standardReport.connection_info = 1;
+        setup_response_manager(before_send, &selectedReports[player]);
+    }
+
+    test_handshake();
+    test_subcommands();
+    test_reports();
+    test_reset();
+    test_interface_stats();
+    return test_report("dual_test");
+}
@@ -0,0 +1,16 @@
+/*
+ * Host build stand-in for <LUFA/Drivers/Peripheral/Serial.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_LUFA_DRIVERS_PERIPHERAL_SERIAL_H
+#define HOSTBUILD_LUFA_DRIVERS_PERIPHERAL_SERIAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+void Serial_Init(uint32_t baud, bool doubleSpeed);
+void Serial_SendByte(char c);
+void Serial_SendString(const char *s);
+bool Serial_IsSendReady(void);
+#define SERIAL_UBBRVAL(b) (b)
+#define SERIAL_2X_UBBRVAL(b) (b)
+
+#endif // HOSTBUILD_LUFA_DRIVERS_PERIPHERAL_SERIAL_H
@@ -0,0 +1,67 @@
+/*
+ * Host build stand-in for <LUFA/Drivers/USB/USB.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_LUFA_DRIVERS_USB_USB_H
+#define HOSTBUILD_LUFA_DRIVERS_USB_USB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#define ENDPOINT_DIR_IN 0x80
+#define ENDPOINT_DIR_OUT 0x00
+#define EP_TYPE_INTERRUPT 3
+#define ENDPOINT_ATTR_NO_SYNC 0
+#define ENDPOINT_USAGE_DATA 0
+#define ENDPOINT_RWSTREAM_NoError 0
+#define FIXED_CONTROL_ENDPOINT_SIZE 64
+#define FIXED_NUM_CONFIGURATIONS 1
+#define NO_DESCRIPTOR 0
+#define LANGUAGE_ID_ENG 0x0409
+#define VERSION_BCD(a,b,c) ((a)<<8|(b)<<4|(c))
+#define USB_STRING_LEN(n) (2 + (n)*2)
+#define USB_CONFIG_POWER_MA(m) ((m)/2)
+#define USB_CONFIG_ATTR_RESERVED 0x80
+#define USB_CONFIG_ATTR_REMOTEWAKEUP 0x20
+enum { DTYPE_Device = 1, DTYPE_Configuration, DTYPE_String, DTYPE_Interface, DTYPE_Endpoint };
+enum { HID_DTYPE_HID = 0x21, HID_DTYPE_Report = 0x22 };
+enum { HID_CSCP_HIDClass = 3, HID_CSCP_NonBootSubclass = 0, HID_CSCP_NonBootProtocol = 0 };
+enum { USB_CSCP_NoDeviceClass = 0, USB_CSCP_NoDeviceSubclass = 0, USB_CSCP_NoDeviceProtocol = 0 };
+enum { HID_REQ_SetIdle = 0x0A };
+enum { REQDIR_HOSTTODEVICE = 0, REQTYPE_CLASS = 0x20, REQREC_INTERFACE = 1 };
+enum { DEVICE_STATE_Unattached, DEVICE_STATE_Powered, DEVICE_STATE_Default, DEVICE_STATE_Addressed, DEVICE_STATE_Configured, DEVICE_STATE_Suspended };
+typedef struct { uint8_t Size, Type; } USB_Descriptor_Header_t;
+typedef struct { USB_Descriptor_Header_t Header; uint16_t TotalConfigurationSize; uint8_t TotalInterfaces, ConfigurationNumber, ConfigurationStrIndex, ConfigAttributes, MaxPowerConsumption; } USB_Descriptor_Configuration_Header_t;
+typedef struct { USB_Descriptor_Header_t Header; uint8_t InterfaceNumber, AlternateSetting, TotalEndpoints, Class, SubClass, Protocol, InterfaceStrIndex; } USB_Descriptor_Interface_t;
+typedef struct { USB_Descriptor_Header_t Header; uint16_t HIDSpec; uint8_t CountryCode, TotalReportDescriptors, HIDReportType; uint16_t HIDReportLength; } USB_HID_Descriptor_HID_t;
+typedef struct { USB_Descriptor_Header_t Header; uint8_t EndpointAddress, Attributes; uint16_t EndpointSize; uint8_t PollingIntervalMS; } USB_Descriptor_Endpoint_t;
+typedef struct { USB_Descriptor_Header_t Header; uint16_t USBSpecification; uint8_t Class, SubClass, Protocol, Endpoint0Size; uint16_t VendorID, ProductID, ReleaseNumber; uint8_t ManufacturerStrIndex, ProductStrIndex, SerialNumStrIndex, NumberOfConfigurations; } USB_Descriptor_Device_t;
+typedef struct { USB_Descriptor_Header_t Header; wchar_t UnicodeString[32]; } USB_Descriptor_String_t;
+typedef uint8_t USB_Descriptor_HIDReport_Datatype_t;
+typedef struct { uint8_t bmRequestType, bRequest; uint16_t wValue, wIndex, wLength; } USB_Request_Header_t;
+extern USB_Request_Header_t USB_ControlRequest;
+extern volatile uint8_t USB_DeviceState;
+extern bool USB_Device_RemoteWakeupEnabled;
+void USB_Init(void);
+void USB_USBTask(void);
+void USB_Device_SendRemoteWakeup(void);
+void Endpoint_SelectEndpoint(uint8_t a);
+bool Endpoint_IsINReady(void);
+bool Endpoint_IsOUTReceived(void);
+bool Endpoint_IsReadWriteAllowed(void);
+uint8_t Endpoint_Read_8(void);
+void Endpoint_Write_8(uint8_t b);
+void Endpoint_ClearOUT(void);
+void Endpoint_ClearIN(void);
+void Endpoint_ClearSETUP(void);
+void Endpoint_ClearStatusStage(void);
+uint16_t Endpoint_BytesInEndpoint(void);
+uint8_t Endpoint_Write_Stream_LE(const void *b, uint16_t l, uint16_t *p);
+bool Endpoint_ConfigureEndpoint(uint8_t a, uint8_t t, uint16_t s, uint8_t banks);
+static inline void GlobalInterruptEnable(void) {}
+static inline void GlobalInterruptDisable(void) {}
+
+#endif // HOSTBUILD_LUFA_DRIVERS_USB_USB_H
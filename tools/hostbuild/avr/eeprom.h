@@ -0,0 +1,19 @@
+/*
+ * Host build stand-in for <avr/eeprom.h>, see tools/hostbuild/host.h
+ * EEMEM variables are ordinary variables, so EEPROM accesses are plain memory accesses.
+ */
+#ifndef HOSTBUILD_AVR_EEPROM_H
+#define HOSTBUILD_AVR_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+#define EEMEM
+#define eeprom_is_ready() 1
+#define eeprom_busy_wait()
+#define eeprom_read_byte(p) (*(const uint8_t *)(p))
+#define eeprom_update_byte(p, v) ((void) (*(uint8_t *)(p) = (v)))
+#define eeprom_write_byte(p, v) ((void) (*(uint8_t *)(p) = (v)))
+#define eeprom_read_block(dst, src, n) ((void) memcpy((dst), (src), (n)))
+#define eeprom_update_block(src, dst, n) ((void) memcpy((dst), (src), (n)))
+
+#endif // HOSTBUILD_AVR_EEPROM_H
@@ -0,0 +1,11 @@
+/*
+ * Host build stand-in for <avr/interrupt.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_AVR_INTERRUPT_H
+#define HOSTBUILD_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+static inline void sei(void) {}
+static inline void cli(void) {}
+
+#endif // HOSTBUILD_AVR_INTERRUPT_H
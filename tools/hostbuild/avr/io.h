@@ -0,0 +1,28 @@
+/*
+ * Host build stand-in for <avr/io.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_AVR_IO_H
+#define HOSTBUILD_AVR_IO_H
+
+#include <stdint.h>
+extern volatile uint8_t UCSR1A, UCSR1B, UCSR1C, UDR1, TCCR1A, TCCR1B, TIMSK1, TIFR1, MCUSR, UENUM, UEINTX, UESTA0X, UDINT, EECR;
+extern volatile uint16_t TCNT1, OCR1A, UBRR1;
+#define _BV(b) (1U << (b))
+#define RXCIE1 7
+#define TXCIE1 6
+#define UDRIE1 5
+#define UDRE1 5
+#define RXC1 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define TOIE1 0
+#define OCIE1A 1
+#define TOV1 0
+#define NBUSYBK0 0
+#define NBUSYBK1 1
+#define SREG_I 7
+#define ISR(v) void v(void)
+
+#endif // HOSTBUILD_AVR_IO_H
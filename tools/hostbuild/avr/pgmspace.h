@@ -0,0 +1,17 @@
+/*
+ * Host build stand-in for <avr/pgmspace.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_AVR_PGMSPACE_H
+#define HOSTBUILD_AVR_PGMSPACE_H
+
+#include <string.h>
+#include <stdint.h>
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p) (*(void * const *)(p))
+#define memcpy_P memcpy
+
+#endif // HOSTBUILD_AVR_PGMSPACE_H
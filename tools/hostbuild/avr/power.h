@@ -0,0 +1,10 @@
+/*
+ * Host build stand-in for <avr/power.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_AVR_POWER_H
+#define HOSTBUILD_AVR_POWER_H
+
+#define clock_div_1 0
+static inline void clock_prescale_set(int x) { (void) x; }
+
+#endif // HOSTBUILD_AVR_POWER_H
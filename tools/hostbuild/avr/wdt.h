@@ -0,0 +1,9 @@
+/*
+ * Host build stand-in for <avr/wdt.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_AVR_WDT_H
+#define HOSTBUILD_AVR_WDT_H
+
+static inline void wdt_disable(void) {}
+
+#endif // HOSTBUILD_AVR_WDT_H
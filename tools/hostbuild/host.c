@@ -0,0 +1,96 @@
+#include "host.h"
+
+#include <string.h>
+#include <avr/io.h>
+#include <LUFA/Drivers/USB/USB.h>
+#include <LUFA/Drivers/Peripheral/Serial.h>
+
+// Registers touched by the firmware
+volatile uint8_t UCSR1A, UCSR1B, UCSR1C, UDR1, TCCR1A, TCCR1B, TIMSK1, TIFR1, MCUSR, UENUM, UEINTX, UESTA0X, UDINT, EECR;
+volatile uint16_t TCNT1, OCR1A, UBRR1;
+
+USB_Request_Header_t USB_ControlRequest;
+volatile uint8_t USB_DeviceState = DEVICE_STATE_Configured;
+bool USB_Device_RemoteWakeupEnabled = false;
+
+uint8_t host_in_packet[HOST_PACKET_SIZE];
+uint8_t host_in_length = 0;
+uint32_t host_in_count = 0;
+uint8_t host_in_endpoint = 0;
+
+static uint8_t pending[HOST_PACKET_SIZE];
+static uint8_t pendingLength = 0;
+static uint32_t now = 0;
+static uint8_t selected = 0; // Endpoint address
+
+void host_clock_set(uint32_t ticks) {
+    now = ticks;
+}
+
+void host_reset_capture(void) {
+    host_in_length = 0;
+    host_in_count = 0;
+    pendingLength = 0;
+}
+
+/*
+ * Clock.c
+ */
+
+void clock_init(void) {
+    now = 0;
+}
+
+uint32_t clock_now(void) {
+    return now;
+}
+
+/*
+ * LUFA USB
+ */
+
+void USB_Init(void) {}
+void USB_USBTask(void) {}
+void USB_Device_SendRemoteWakeup(void) {}
+
+void Endpoint_SelectEndpoint(uint8_t address) { selected = address; }
+bool Endpoint_IsINReady(void) { return true; }
+bool Endpoint_IsOUTReceived(void) { return false; }
+bool Endpoint_IsReadWriteAllowed(void) { return pendingLength < HOST_PACKET_SIZE; }
+uint8_t Endpoint_Read_8(void) { return 0; }
+void Endpoint_ClearOUT(void) {}
+void Endpoint_ClearSETUP(void) {}
+void Endpoint_ClearStatusStage(void) {}
+uint16_t Endpoint_BytesInEndpoint(void) { return pendingLength; }
+bool Endpoint_ConfigureEndpoint(uint8_t a, uint8_t t, uint16_t s, uint8_t banks) { return true; }
+
+void Endpoint_Write_8(uint8_t b) {
+    if (pendingLength < HOST_PACKET_SIZE) {
+        pending[pendingLength++] = b;
+    }
+}
+
+uint8_t Endpoint_Write_Stream_LE(const void *buffer, uint16_t length, uint16_t *processed) {
+    const uint8_t *b = buffer;
+    for (uint16_t i = 0; i < length; i++) {
+        Endpoint_Write_8(b[i]);
+    }
+    return ENDPOINT_RWSTREAM_NoError;
+}
+
+void Endpoint_ClearIN(void) {
+    memcpy(host_in_packet, pending, pendingLength);
+    host_in_length = pendingLength;
+    host_in_endpoint = selected;
+    host_in_count++;
+    pendingLength = 0;
+}
+
+/*
+ * LUFA Serial, bytes sent to the PC are discarded
+ */
+
+void Serial_Init(uint32_t baud, bool doubleSpeed) {}
+void Serial_SendByte(char c) {}
+void Serial_SendString(const char *s) {}
+bool Serial_IsSendReady(void) { return true; }
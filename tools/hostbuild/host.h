@@ -0,0 +1,25 @@
+/*
+ * Host build of the firmware.
+ *
+ * Response.c, HostLink.c, EmulatedSPI.c and Trace.c compile unchanged for Linux against the stand-in headers in this
+ * directory. host.c replaces the hardware: IN packets written to the endpoint are captured, UART bytes are discarded,
+ * and the clock only moves when host_clock_set() is called, so runs are deterministic and as fast as the CPU allows.
+ */
+#ifndef HOSTBUILD_HOST_H
+#define HOSTBUILD_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HOST_PACKET_SIZE 64
+
+// Last packet sent with Endpoint_ClearIN()
+extern uint8_t host_in_packet[HOST_PACKET_SIZE];
+extern uint8_t host_in_length;
+extern uint32_t host_in_count;
+extern uint8_t host_in_endpoint; // Address of the endpoint it was written to
+
+void host_clock_set(uint32_t ticks);
+void host_reset_capture(void);
+
+#endif // HOSTBUILD_HOST_H
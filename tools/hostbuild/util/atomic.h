@@ -0,0 +1,11 @@
+/*
+ * Host build stand-in for <util/atomic.h>, see tools/hostbuild/host.h
+ */
+#ifndef HOSTBUILD_UTIL_ATOMIC_H
+#define HOSTBUILD_UTIL_ATOMIC_H
+
+#define ATOMIC_BLOCK(x) for (int _once = 1; _once; _once = 0)
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON 1
+
+#endif // HOSTBUILD_UTIL_ATOMIC_H
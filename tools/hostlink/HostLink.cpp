@@ -0,0 +1,287 @@
+#include "HostLink.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace hostlink {
+
+void InputState::set_button(Button button, bool pressed) {
+    uint8_t index = static_cast<uint8_t>(button);
+    uint8_t mask = 1 << (index & 7);
+    if (pressed) {
+        bytes[index >> 3] |= mask;
+    } else {
+        bytes[index >> 3] &= ~mask;
+    }
+}
+
+bool InputState::button(Button button) const {
+    uint8_t index = static_cast<uint8_t>(button);
+    return bytes[index >> 3] & (1 << (index & 7));
+}
+
+void InputState::set_stick(size_t offset, uint16_t x, uint16_t y) {
+    x &= 0xFFF;
+    y &= 0xFFF;
+    bytes[offset] = x & 0xFF;
+    bytes[offset + 1] = ((y & 0x0F) << 4) | (x >> 8);
+    bytes[offset + 2] = y >> 4;
+}
+
+size_t encode_frame(uint8_t type, const uint8_t *payload, uint8_t length, uint8_t *out) {
+    uint8_t checksum = type ^ length;
+    out[0] = kSync;
+    out[1] = type;
+    out[2] = length;
+    for (uint8_t i = 0; i < length; i++) {
+        out[3 + i] = payload[i];
+        checksum ^= payload[i];
+    }
+    out[3 + length] = checksum;
+    return length + kFrameOverhead;
+}
+
+bool FrameParser::feed(uint8_t b) {
+    switch (state_) {
+        case State::Sync:
+            if (b == kSync) {
+                state_ = State::Type;
+            }
+            return false;
+        case State::Type:
+            type_ = b;
+            checksum_ = b;
+            state_ = State::Length;
+            return false;
+        case State::Length:
+            length_ = b;
+            checksum_ ^= b;
+            count_ = 0;
+            state_ = (b == 0) ? State::Checksum : State::Payload;
+            return false;
+        case State::Payload:
+            payload_[count_++] = b;
+            checksum_ ^= b;
+            if (count_ == length_) {
+                state_ = State::Checksum;
+            }
+            return false;
+        case State::Checksum:
+            state_ = State::Sync;
+            if (b != checksum_) {
+                errors_++;
+                return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+static bool to_speed(unsigned baud, speed_t *speed) {
+    switch (baud) {
+        case 9600:    *speed = B9600; return true;
+        case 19200:   *speed = B19200; return true;
+        case 38400:   *speed = B38400; return true;
+        case 57600:   *speed = B57600; return true;
+        case 115200:  *speed = B115200; return true;
+        case 230400:  *speed = B230400; return true;
+        case 460800:  *speed = B460800; return true;
+        case 500000:  *speed = B500000; return true;
+        case 1000000: *speed = B1000000; return true;
+        case 2000000: *speed = B2000000; return true;
+        default:      return false;
+    }
+}
+
+Link::~Link() {
+    close();
+}
+
+bool Link::open(const std::string &path, unsigned baud) {
+    close();
+    speed_t speed;
+    if (!to_speed(baud, &speed)) {
+        errno = EINVAL;
+        return false;
+    }
+    fd_ = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    termios tio;
+    if (tcgetattr(fd_, &tio) != 0) {
+        close();
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (cfsetispeed(&tio, speed) != 0 || cfsetospeed(&tio, speed) != 0 || tcsetattr(fd_, TCSANOW, &tio) != 0) {
+        int error = errno;
+        close();
+        errno = error;
+        return false;
+    }
+    tcflush(fd_, TCIOFLUSH);
+
+    tx_length_ = tx_offset_ = 0;
+    pending_ = false;
+    last_sent_ = Clock::time_point();
+    line_free_ = Clock::time_point();
+    set_line_rate(baud / 10); // 8N1: 10 bits per byte
+    return true;
+}
+
+void Link::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void Link::set_line_rate(unsigned bytes_per_second) {
+    byte_time_ = std::chrono::nanoseconds(bytes_per_second ? 1000000000ULL / bytes_per_second : 0);
+}
+
+void Link::set_frame_handler(FrameHandler handler, void *context) {
+    handler_ = handler;
+    handler_context_ = context;
+}
+
+void Link::submit(const InputState &state) {
+    stats_.submitted++;
+    if (pending_) {
+        stats_.coalesced++;
+    } else {
+        pending_since_ = Clock::now();
+    }
+    current_ = state;
+    pending_ = true;
+}
+
+bool Link::send(uint8_t type, const uint8_t *payload, uint8_t length) {
+    if (length > kMaxPayload) {
+        errno = EMSGSIZE;
+        return false;
+    }
+    if (tx_offset_ != tx_length_) {
+        return false;
+    }
+    tx_length_ = encode_frame(type, payload, length, tx_.data());
+    tx_offset_ = 0;
+    tx_is_state_ = false;
+    tx_is_input_ = false;
+    return true;
+}
+
+bool Link::poll() {
+    if (fd_ < 0) {
+        errno = EBADF;
+        return false;
+    }
+    if (!receive() || !flush()) {
+        return false;
+    }
+
+    // Only start a new input frame once the driver has sent the previous one, so the newest state always goes next
+    Clock::time_point now = Clock::now();
+    if (tx_offset_ != tx_length_ || now < line_free_ || !driver_idle()) {
+        return true;
+    }
+    bool due = pending_ ? now - last_sent_ >= min_interval_
+                        : keepalive_.count() != 0 && now - last_sent_ >= keepalive_;
+    if (!due) {
+        return true;
+    }
+    tx_length_ = encode_frame(kInputState, current_.bytes.data(), InputState::kSize, tx_.data());
+    tx_offset_ = 0;
+    tx_is_state_ = true;
+    tx_is_input_ = pending_; // Keepalives repeat an old state, they don't count towards latency
+    tx_submitted_ = pending_since_;
+    pending_ = false;
+    last_sent_ = now;
+    return flush();
+}
+
+bool Link::flush() {
+    while (tx_offset_ < tx_length_) {
+        ssize_t n = ::write(fd_, tx_.data() + tx_offset_, tx_length_ - tx_offset_);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                stats_.write_stalls++;
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        stats_.bytes_sent += n;
+        tx_offset_ += n;
+        Clock::time_point now = Clock::now();
+        line_free_ = (line_free_ > now ? line_free_ : now) + byte_time_ * n;
+        if (tx_offset_ < tx_length_) {
+            stats_.write_stalls++;
+            return true;
+        }
+    }
+    if (tx_length_ != 0 && !tx_is_state_) {
+        stats_.other_frames_sent++;
+    } else if (tx_length_ != 0) {
+        stats_.frames_sent++;
+        if (tx_is_input_) {
+            auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tx_submitted_);
+            stats_.latency_total += latency;
+            stats_.latency_samples++;
+            if (latency > stats_.latency_max) {
+                stats_.latency_max = latency;
+            }
+        }
+    }
+    tx_length_ = tx_offset_ = 0;
+    return true;
+}
+
+bool Link::receive() {
+    uint8_t buffer[256];
+    for (;;) {
+        ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (parser_.feed(buffer[i])) {
+                stats_.frames_received++;
+                if (handler_ != nullptr) {
+                    handler_(handler_context_, parser_.type(), parser_.payload(), parser_.length());
+                }
+            }
+        }
+        stats_.rx_errors = parser_.errors();
+    }
+}
+
+bool Link::driver_idle() const {
+    int queued = 0;
+    if (ioctl(fd_, TIOCOUTQ, &queued) != 0) {
+        return true; // Not a tty, rely on write() backpressure
+    }
+    return queued == 0;
+}
+
+} // namespace hostlink
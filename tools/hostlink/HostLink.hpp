@@ -0,0 +1,197 @@
+/*
+ * PC side of the adapter's UART protocol (see HostLink.h in the firmware), for Linux.
+ *
+ *   hostlink::Link link;
+ *   link.open("/dev/ttyUSB0", 1000000);
+ *   hostlink::InputState state;
+ *   state.set_button(hostlink::Button::A, true);
+ *   link.submit(state);
+ *   for (;;) { link.poll(); ... }
+ *
+ * Nothing blocks and nothing allocates after open(). submit() only stores the state; poll() sends it once the
+ * previous frame has left the serial driver and had time to go out at the line rate, so states submitted faster than
+ * the line (or the console's 8 ms USB poll) can carry them are coalesced and only the newest one is sent. The driver
+ * queue alone isn't enough: USB serial bridges and pseudo-terminals report it empty while bytes are still buffered.
+ * The current state is repeated every keepalive interval so the adapter's stream timeout doesn't release the inputs.
+ */
+#ifndef HOSTLINK_HPP
+#define HOSTLINK_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <termios.h>
+
+namespace hostlink {
+
+constexpr uint8_t kSync = 0xA5;
+constexpr size_t kFrameOverhead = 4;
+constexpr size_t kMaxPayload = 16;            // HOSTLINK_MAX_PAYLOAD, longer frames are dropped by the firmware
+constexpr size_t kMaxReceivedPayload = 255;   // Frames from the adapter (traces) may be longer
+
+// Frame types, same values as HostLink_Frame_t in the firmware
+enum FrameType : uint8_t {
+    kInputState        = 0x01,
+    kConfig            = 0x02,
+    kTasFrame          = 0x03,
+    kTurbo             = 0x04,
+    kRemap             = 0x05,
+    kSourceState       = 0x06,
+    kMixer             = 0x07,
+    kRecordLoad        = 0x08,
+    kStatsRequest      = 0x09,
+    kEventPlayerLights = 0x10,
+    kEventHomeLight    = 0x11,
+    kEventReportMode   = 0x12,
+    kEventImu          = 0x13,
+    kEventVibration    = 0x14,
+    kTasAck            = 0x18,
+    kTrace             = 0x20,
+    kLog               = 0x21,
+    kRecord            = 0x22,
+    kStats             = 0x23,
+};
+
+// Set in the type of frames about the second controller of an ADAPTER_DUAL adapter, e.g. kInputState | kPlayer2
+constexpr uint8_t kPlayer2 = 0x40;
+
+// Bit index in the 3 button bytes of USB_StandardReport_t
+enum class Button : uint8_t {
+    Y = 0, X, B, A, RightSR, RightSL, R, ZR,
+    Minus = 8, Plus, RightStick, LeftStick, Home, Capture, Grip = 15,
+    Down = 16, Up, Right, Left, LeftSR, LeftSL, L, ZL,
+};
+
+/*
+ * Bytes 1-9 of USB_StandardReport_t, the HOSTLINK_INPUT_STATE payload: 3 button bytes, then two sticks packed as
+ * 12-bit X and Y values. Starts with nothing pressed and both sticks centered.
+ */
+struct InputState {
+    static constexpr size_t kSize = 9;
+    std::array<uint8_t, kSize> bytes = {0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80};
+
+    void set_button(Button button, bool pressed);
+    bool button(Button button) const;
+    // 0-4095, 2048 is centered
+    void set_left_stick(uint16_t x, uint16_t y) { set_stick(3, x, y); }
+    void set_right_stick(uint16_t x, uint16_t y) { set_stick(6, x, y); }
+
+    bool operator==(const InputState &other) const { return bytes == other.bytes; }
+    bool operator!=(const InputState &other) const { return bytes != other.bytes; }
+
+private:
+    void set_stick(size_t offset, uint16_t x, uint16_t y);
+};
+
+/*
+ * Write one frame to 'out', which must hold length + kFrameOverhead bytes. Returns the frame size.
+ */
+size_t encode_frame(uint8_t type, const uint8_t *payload, uint8_t length, uint8_t *out);
+
+/*
+ * Frame parser, the same state machine as the firmware's. Returns true when 'b' completed a valid frame, which is
+ * then available through type(), payload() and length() until the next call.
+ */
+class FrameParser {
+public:
+    bool feed(uint8_t b);
+    uint8_t type() const { return type_; }
+    const uint8_t *payload() const { return payload_.data(); }
+    uint8_t length() const { return length_; }
+    uint32_t errors() const { return errors_; }
+
+private:
+    enum class State { Sync, Type, Length, Payload, Checksum };
+    State state_ = State::Sync;
+    uint8_t type_ = 0;
+    uint8_t length_ = 0;
+    uint8_t count_ = 0;
+    uint8_t checksum_ = 0;
+    uint32_t errors_ = 0;
+    std::array<uint8_t, kMaxReceivedPayload> payload_{};
+};
+
+struct Stats {
+    uint64_t submitted = 0;      // submit() calls
+    uint64_t coalesced = 0;      // Submitted states replaced by a newer one before being sent
+    uint64_t frames_sent = 0;    // Input frames fully handed to the driver, including keepalives
+    uint64_t other_frames_sent = 0; // Frames queued with send(), whatever their type
+    uint64_t bytes_sent = 0;
+    uint64_t write_stalls = 0;   // write() calls that couldn't take the whole frame
+    uint64_t frames_received = 0;
+    uint64_t rx_errors = 0;
+    // Time from submit() of a state to its frame being handed to the driver
+    std::chrono::nanoseconds latency_max{0};
+    std::chrono::nanoseconds latency_total{0};
+    uint64_t latency_samples = 0;
+};
+
+class Link {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Called from poll() for every frame received from the adapter (console events, TAS acks, traces)
+    using FrameHandler = void (*)(void *context, uint8_t type, const uint8_t *payload, uint8_t length);
+
+    Link() = default;
+    ~Link();
+    Link(const Link &) = delete;
+    Link &operator=(const Link &) = delete;
+
+    // Open and configure the port as 8N1 raw, non-blocking, and set the line rate to match 'baud'.
+    // Returns false with errno set on failure (EINVAL for a baud rate termios doesn't have).
+    bool open(const std::string &path, unsigned baud);
+    void close();
+    int fd() const { return fd_; }
+
+    void set_frame_handler(FrameHandler handler, void *context);
+    // Don't send input frames closer together than this, e.g. the console's 8 ms poll (0 = as fast as the line allows)
+    void set_min_interval(std::chrono::microseconds interval) { min_interval_ = interval; }
+    // Bytes per second the line carries, 0 = don't pace (only the driver queue limits writes)
+    void set_line_rate(unsigned bytes_per_second);
+    // Repeat the current state if nothing was sent for this long, keep it under ADAPTER_STREAM_TIMEOUT_MS
+    void set_keepalive(std::chrono::microseconds interval) { keepalive_ = interval; }
+
+    void submit(const InputState &state);
+    // Queue any frame type; returns false if a frame is still being written, poll() and try again. Payloads longer
+    // than kMaxPayload would be dropped by the adapter, they are refused with false and errno EMSGSIZE.
+    bool send(uint8_t type, const uint8_t *payload, uint8_t length);
+    // Do all pending I/O without blocking. Returns false if the port failed (errno set).
+    bool poll();
+
+    const Stats &stats() const { return stats_; }
+
+private:
+    bool flush();
+    bool receive();
+    bool driver_idle() const;
+
+    int fd_ = -1;
+    FrameHandler handler_ = nullptr;
+    void *handler_context_ = nullptr;
+    std::chrono::microseconds min_interval_{0};
+    std::chrono::microseconds keepalive_{100000};
+    std::chrono::nanoseconds byte_time_{0};
+    Clock::time_point line_free_; // When the bytes written so far have left the line
+
+    InputState current_;
+    bool pending_ = false;
+    Clock::time_point pending_since_;
+    Clock::time_point last_sent_;
+
+    std::array<uint8_t, kMaxPayload + kFrameOverhead> tx_{};
+    size_t tx_length_ = 0;
+    size_t tx_offset_ = 0;
+    bool tx_is_state_ = false; // The frame in tx_ was started by poll() (an input frame), not by send()
+    bool tx_is_input_ = false;
+    Clock::time_point tx_submitted_;
+
+    FrameParser parser_;
+    Stats stats_;
+};
+
+} // namespace hostlink
+
+#endif // HOSTLINK_HPP
@@ -0,0 +1,133 @@
+/*
+ * Throughput benchmark for the host library (tools/hostlink), built by "make -C tools".
+ *
+ * The library writes to one end of a pseudo-terminal pair. The other end is read by the firmware's own frame parser
+ * (HostLink.c, host build), standing in for the adapter. The benchmark submits a new state on every loop pass, as
+ * fast as it can, and reports how many updates per second the adapter side receives. Each state carries a sequence
+ * number in its stick bytes, so lost checksums and reordering would show up.
+ *
+ * Usage: hostlink_bench [-t seconds] [-b baud] [-i min_interval_us]
+ *   -b  UART speed: the adapter side reads no faster than the line would deliver (default 1000000).
+ *       0 measures the library alone, with no line pacing.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hostlink/HostLink.hpp"
+
+extern "C" {
+#include "HostLink.h"
+}
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t received = 0;
+static uint64_t reordered = 0;
+static uint32_t lastSequence = 0;
+
+static uint32_t sequence_of(const uint8_t *state) {
+    return state[3] | (state[4] << 8) | (state[5] << 16);
+}
+
+extern "C" void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+    if (type != HOSTLINK_INPUT_STATE || length != REPORT_INPUT_BYTES) {
+        return;
+    }
+    uint32_t sequence = sequence_of(payload);
+    if (received != 0 && sequence <= lastSequence) {
+        reordered++;
+    }
+    lastSequence = sequence;
+    received++;
+}
+
+int main(int argc, char *argv[]) {
+    double seconds = 2.0;
+    long baud = 1000000;
+    long interval = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:i:")) != -1) {
+        switch (opt) {
+            case 't': seconds = atof(optarg); break;
+            case 'b': baud = atol(optarg); break;
+            case 'i': interval = atol(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-t seconds] [-b baud] [-i min_interval_us]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    hostlink::Link link;
+    if (!link.open(ptsname(master), baud ? baud : 1000000)) {
+        perror(ptsname(master));
+        return 1;
+    }
+    if (baud == 0) {
+        link.set_line_rate(0);
+    }
+    link.set_min_interval(std::chrono::microseconds(interval));
+
+    hostlink::InputState state;
+    uint32_t sequence = 0;
+    double budget = 0; // Bytes the adapter side may read, with -b
+    uint8_t buffer[256];
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point previous = start;
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    for (;;) {
+        Clock::time_point now = Clock::now();
+        if (now >= end) break;
+
+        sequence++;
+        state.bytes[3] = sequence & 0xFF;
+        state.bytes[4] = (sequence >> 8) & 0xFF;
+        state.bytes[5] = (sequence >> 16) & 0xFF;
+        state.set_button(hostlink::Button::A, sequence & 1);
+        link.submit(state);
+        if (!link.poll()) {
+            perror("poll");
+            return 1;
+        }
+
+        size_t want = sizeof(buffer);
+        if (baud != 0) {
+            budget += std::chrono::duration<double>(now - previous).count() * baud / 10;
+            if (budget > sizeof(buffer)) budget = sizeof(buffer);
+            want = (size_t) budget;
+        }
+        previous = now;
+        if (want == 0) continue;
+        ssize_t n = read(master, buffer, want);
+        for (ssize_t i = 0; i < n; i++) {
+            hostlink_receive_byte(buffer[i]);
+        }
+        if (n > 0 && baud != 0) {
+            budget -= n;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const hostlink::Stats &stats = link.stats();
+    double latencyAvg = stats.latency_samples ? stats.latency_total.count() / 1000.0 / stats.latency_samples : 0;
+    printf("submitted       %10.0f updates/s\n", stats.submitted / elapsed);
+    printf("sent            %10.0f frames/s (%llu bytes)\n", stats.frames_sent / elapsed,
+           (unsigned long long) stats.bytes_sent);
+    printf("received        %10.0f updates/s\n", received / elapsed);
+    printf("coalesced       %10llu\n", (unsigned long long) stats.coalesced);
+    printf("write stalls    %10llu\n", (unsigned long long) stats.write_stalls);
+    printf("latency         %10.1f us avg, %.1f us max (submit to driver)\n", latencyAvg,
+           stats.latency_max.count() / 1000.0);
+    printf("adapter errors  %10u checksum, %llu reordered\n", hostlink_rx_errors(), (unsigned long long) reordered);
+    return hostlink_rx_errors() != 0 || reordered != 0;
+}
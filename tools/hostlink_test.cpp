@@ -0,0 +1,156 @@
+/*
+ * End-to-end test of the host library (tools/hostlink) against the host build of the firmware, run by
+ * "make -C tools test".
+ *
+ * The library writes to one end of a pseudo-terminal pair. The other end is read by the firmware's frame parser
+ * (HostLink.c), and input frames are copied into the report the way adapter_switch.c does. The console side
+ * (test_console.c) then polls the reports Response.c builds, so a state submitted on the PC is checked byte for byte
+ * in the packet the Switch gets.
+ */
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hostlink/HostLink.hpp"
+#include "test_console.h"
+
+extern "C" {
+#include "host.h"
+#include "Response.h"
+}
+
+using Clock = std::chrono::steady_clock;
+
+static USB_ExtendedReport_t report;
+static USB_ExtendedReport_t *selectedReport = &report;
+static unsigned inputFrames = 0;
+static unsigned otherFrames = 0;
+
+static bool before_send(void) {
+    return true;
+}
+
+// Same as the HOSTLINK_INPUT_STATE case in adapter_switch.c, without the input latch
+extern "C" void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+    if (type == HOSTLINK_INPUT_STATE && length == REPORT_INPUT_BYTES) {
+        memcpy(REPORT_BUTTONS(&report.standardReport), payload, REPORT_INPUT_BYTES);
+        inputFrames++;
+    } else {
+        otherFrames++;
+    }
+}
+
+/*
+ * Run the library and the adapter side until 'frames' more frames have reached the adapter, or a second has passed.
+ */
+static bool pump(hostlink::Link &link, int master, unsigned frames) {
+    unsigned target = inputFrames + otherFrames + frames;
+    Clock::time_point end = Clock::now() + std::chrono::seconds(1);
+    while (inputFrames + otherFrames < target) {
+        if (Clock::now() >= end || !link.poll()) {
+            return false;
+        }
+        uint8_t buffer[256];
+        ssize_t n = read(master, buffer, sizeof(buffer));
+        for (ssize_t i = 0; i < n; i++) {
+            hostlink_receive_byte(buffer[i]);
+        }
+    }
+    return true;
+}
+
+// A submitted state ends up in bytes 3-11 of the next 0x30 report
+static void test_state_in_report(hostlink::Link &link, int master) {
+    hostlink::InputState state;
+    state.set_button(hostlink::Button::A, true);
+    state.set_button(hostlink::Button::ZL, true);
+    state.set_button(hostlink::Button::Down, true);
+    state.set_left_stick(0, 4095);
+    state.set_right_stick(4095, 0);
+    link.submit(state);
+    CHECK(pump(link, master, 1));
+
+    const uint8_t *packet = console_poll();
+    CHECK(packet != NULL && packet[0] == 0x30);
+    CHECK_BYTES(packet ? &packet[3] : NULL, state.bytes.data(), hostlink::InputState::kSize);
+}
+
+// States submitted between two polls of the library are coalesced, only the newest one reaches the report
+static void test_coalescing(hostlink::Link &link, int master) {
+    hostlink::Stats before = link.stats();
+    hostlink::InputState state;
+    for (uint16_t i = 0; i < 50; i++) {
+        state.set_left_stick(i * 80, 2048);
+        link.submit(state);
+    }
+    CHECK(pump(link, master, 1));
+    CHECK(link.stats().submitted - before.submitted == 50);
+    CHECK(link.stats().coalesced - before.coalesced == 49);
+    CHECK(link.stats().frames_sent - before.frames_sent == 1);
+
+    const uint8_t *packet = console_poll();
+    CHECK_BYTES(packet ? &packet[3] : NULL, state.bytes.data(), hostlink::InputState::kSize);
+}
+
+// Frames queued with send() are counted apart from the input frames, even when they are input states
+static void test_send_counts(hostlink::Link &link, int master) {
+    hostlink::Stats before = link.stats();
+    const uint8_t request[] = {HOSTLINK_STATS_STREAM, 0};
+    while (!link.send(hostlink::kStatsRequest, request, sizeof(request))) {
+        link.poll();
+    }
+    CHECK(pump(link, master, 1));
+
+    hostlink::InputState state;
+    state.set_button(hostlink::Button::Home, true);
+    while (!link.send(hostlink::kInputState, state.bytes.data(), hostlink::InputState::kSize)) {
+        link.poll();
+    }
+    CHECK(pump(link, master, 1));
+
+    CHECK(link.stats().other_frames_sent - before.other_frames_sent == 2);
+    CHECK(link.stats().frames_sent == before.frames_sent);
+    CHECK(link.stats().latency_samples == before.latency_samples);
+
+    const uint8_t *packet = console_poll();
+    CHECK_BYTES(packet ? &packet[3] : NULL, state.bytes.data(), hostlink::InputState::kSize);
+}
+
+// The firmware drops frames longer than HOSTLINK_MAX_PAYLOAD, so the library refuses to send them
+static void test_payload_limit(hostlink::Link &link) {
+    static_assert(hostlink::kMaxPayload == HOSTLINK_MAX_PAYLOAD, "payload limit differs from the firmware's");
+    uint8_t payload[HOSTLINK_MAX_PAYLOAD + 1] = {0};
+    errno = 0;
+    CHECK(!link.send(hostlink::kRecordLoad, payload, sizeof(payload)));
+    CHECK(errno == EMSGSIZE);
+    link.poll();
+    CHECK(link.send(hostlink::kRecordLoad, payload, HOSTLINK_MAX_PAYLOAD) || errno != EMSGSIZE);
+}
+
+int main() {
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    hostlink::Link link;
+    if (!link.open(ptsname(master), 1000000)) {
+        perror(ptsname(master));
+        return 1;
+    }
+    link.set_keepalive(std::chrono::microseconds(0)); // Only the frames the tests ask for
+
+    setup_response_manager(before_send, &selectedReport);
+    console_handshake();
+
+    test_state_in_report(link, master);
+    test_coalescing(link, master);
+    test_send_counts(link, master);
+    test_payload_limit(link);
+    CHECK(hostlink_rx_errors() == 0);
+    return test_report("hostlink_test");
+}
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Print the event log of an adapter built with ADAPTER_LOG, from a capture of its UART output.
+
+Usage: python3 tools/log_decode.py capture.bin
+       python3 tools/log_decode.py /dev/ttyUSB0 [-b 1000000]
+       some_capture_tool | python3 tools/log_decode.py -
+
+HOSTLINK_LOG frames are picked out of the byte stream, other frames (console events, TAS acks, traces) and bytes
+with a bad checksum are skipped. The messages come from the comments on Log_Event_t in Log.h, so the decoder
+follows the firmware without changes. Times are in milliseconds from the first record; the 24 bit timestamps wrap
+every 268 s and are unwrapped as long as records arrive more often than that.
+"""
+import argparse
+import os
+import re
+import sys
+
+SYNC = 0xA5
+FRAME_LOG = 0x21
+RECORD_SIZE = 8
+TICK_US = 16  # Clock.h, F_CPU / 256 at 16 MHz
+STAMP_WRAP = 1 << 24
+
+LOG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'Log.h')
+
+
+def load_messages(path):
+    """Map event ids to the message comments of Log_Event_t."""
+    with open(path) as f:
+        text = f.read()
+    body = re.search(r'typedef enum \{(.*?)\} Log_Event_t;', text, re.S).group(1)
+    messages = {}
+    for name, value, message in re.findall(r'(LOG_\w+)\s*=\s*(0x[0-9A-Fa-f]+|\d+),\s*//\s*(.*)', body):
+        messages[int(value, 0)] = (name, message.strip())
+    return messages
+
+
+def frames(stream):
+    """Yield (type, payload) for every frame with a valid checksum."""
+    buffer = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buffer += chunk
+        while True:
+            start = buffer.find(SYNC)
+            if start < 0:
+                buffer.clear()
+                break
+            del buffer[:start]
+            if len(buffer) < 3:
+                break
+            length = buffer[2]
+            if len(buffer) < length + 4:
+                break
+            checksum = 0
+            for b in buffer[1:3 + length]:
+                checksum ^= b
+            if checksum != buffer[3 + length]:
+                del buffer[0]  # Not a frame start after all, resync on the next sync byte
+                continue
+            yield buffer[1], bytes(buffer[3:3 + length])
+            del buffer[:length + 4]
+
+
+def format_record(messages, event, args):
+    name, message = messages.get(event, ('?', 'unknown event 0x%02x' % event))
+    try:
+        return message.format(*args, w0=args[0] | (args[1] << 8), w2=args[2] | (args[3] << 8))
+    except (IndexError, ValueError):
+        return '%s %s' % (name, args.hex(' '))
+
+
+def open_input(path, baud):
+    if path == '-':
+        return sys.stdin.buffer
+    if path.startswith('/dev/'):
+        import termios
+        fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, 'B%d' % baud)
+        attrs[0] = attrs[1] = attrs[3] = 0          # Raw input
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[4] = attrs[5] = speed
+        attrs[6][termios.VMIN] = 1
+        attrs[6][termios.VTIME] = 0
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        return os.fdopen(fd, 'rb', buffering=0)
+    return open(path, 'rb')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('input', help='capture file, serial port or - for stdin')
+    parser.add_argument('-b', '--baud', type=int, default=1000000, help='serial port speed')
+    parser.add_argument('--log-h', default=LOG_H, help='Log.h with the event messages')
+    args = parser.parse_args()
+
+    messages = load_messages(args.log_h)
+    first = None
+    last = 0
+    wraps = 0
+    try:
+        for frame_type, payload in frames(open_input(args.input, args.baud)):
+            if frame_type != FRAME_LOG or len(payload) % RECORD_SIZE:
+                continue
+            for i in range(0, len(payload), RECORD_SIZE):
+                record = payload[i:i + RECORD_SIZE]
+                stamp = record[1] | (record[2] << 8) | (record[3] << 16)
+                if stamp < last:
+                    wraps += 1
+                last = stamp
+                ticks = wraps * STAMP_WRAP + stamp
+                if first is None:
+                    first = ticks
+                print('%12.3f  %s' % ((ticks - first) * TICK_US / 1000.0, format_record(messages, record[0], record[4:])),
+                      flush=True)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""
+Work with input recordings of an adapter built with ADAPTER_RECORD_EEPROM_SIZE (see Record.h).
+
+Usage: python3 tools/record_tool.py extract capture.bin -o recording.bin
+       python3 tools/record_tool.py show recording.bin
+       python3 tools/record_tool.py load recording.bin /dev/ttyUSB0 [-b 1000000]
+
+extract  collects the HOSTLINK_RECORD frames of a UART capture (an export, then the part streamed live after the
+         EEPROM filled up, in that order) into one stream file.
+show     prints the states of a stream file, one line per state with the number of reports it lasts.
+load     stores a stream file in the adapter's EEPROM for playback. Only the part that fits is sent, paced to the
+         EEPROM's write speed.
+"""
+import argparse
+import os
+import sys
+import time
+
+SYNC = 0xA5
+FRAME_CONFIG = 0x02
+FRAME_RECORD_LOAD = 0x08
+FRAME_RECORD = 0x22
+CONFIG_RECORD_MODE = 0x06
+MODE_IDLE, MODE_LOADING = 0, 4
+KIND_LIVE, KIND_EXPORT, KIND_END = 0, 1, 2
+
+NEUTRAL = bytes([0x00, 0x00, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80])
+LOAD_CHUNK = 14             # Bytes per load frame, within HOSTLINK_MAX_PAYLOAD
+EEPROM_BYTE_TIME = 0.0036   # 3.4 ms per EEPROM byte, with a margin
+EEPROM_SIZE = 960           # ADAPTER_RECORD_EEPROM_SIZE
+
+
+def frames(data):
+    """Yield (type, payload) for every frame with a valid checksum."""
+    i = 0
+    while i + 3 < len(data):
+        if data[i] != SYNC:
+            i += 1
+            continue
+        length = data[i + 2]
+        end = i + 3 + length
+        if end >= len(data):
+            break
+        checksum = 0
+        for b in data[i + 1:end]:
+            checksum ^= b
+        if checksum != data[end]:
+            i += 1
+            continue
+        yield data[i + 1], data[i + 3:end]
+        i = end + 1
+
+
+def decode(stream):
+    """Yield (state, reports) for every run of identical states."""
+    state = bytearray(NEUTRAL)
+    i = 0
+    while i < len(stream):
+        token = stream[i]
+        i += 1
+        if token & 0x80:
+            count = token & 0x3F
+            if token & 0x40:
+                count = (count << 8) | stream[i]
+                i += 1
+            yield bytes(state), count + 1
+            continue
+        if token == 0 or token > 0x1F:
+            raise ValueError('bad token 0x%02x at %d' % (token, i - 1))
+        for b in range(3):
+            if token & (1 << b):
+                state[b] = stream[i]
+                i += 1
+        for s in range(2):
+            if token & (0x08 << s):
+                state[3 + 3 * s:6 + 3 * s] = stream[i:i + 3]
+                i += 3
+        yield bytes(state), 1
+
+
+def encode_frame(frame_type, payload):
+    checksum = frame_type ^ len(payload)
+    for b in payload:
+        checksum ^= b
+    return bytes([SYNC, frame_type, len(payload)]) + bytes(payload) + bytes([checksum])
+
+
+def extract(args):
+    with open(args.capture, 'rb') as f:
+        data = f.read()
+    exported = bytearray()
+    live = bytearray()
+    complete = False
+    for frame_type, payload in frames(data):
+        if frame_type != FRAME_RECORD or not payload:
+            continue
+        if payload[0] == KIND_EXPORT:
+            exported += payload[1:]
+        elif payload[0] == KIND_LIVE:
+            live += payload[1:]
+        elif payload[0] == KIND_END:
+            complete = True
+    if exported and not complete:
+        print('warning: the export is incomplete', file=sys.stderr)
+    stream = exported + live
+    with open(args.output, 'wb') as f:
+        f.write(stream)
+    print('%s: %d bytes (%d exported, %d streamed live)' % (args.output, len(stream), len(exported), len(live)))
+    return 0
+
+
+def show(args):
+    with open(args.recording, 'rb') as f:
+        stream = f.read()
+    runs = []  # [first report, state, reports]
+    total = 0
+    for state, n in decode(stream):
+        if runs and runs[-1][1] == state:
+            runs[-1][2] += n
+        else:
+            runs.append([total, state, n])
+        total += n
+    for first, state, n in runs:
+        print('%8d  %s  x%d' % (first, state.hex(' '), n))
+    print('%d reports, %.1f s at 125 Hz, %d bytes (%.2f bytes per report)' %
+          (total, total / 125.0, len(stream), len(stream) / total if total else 0))
+    return 0
+
+
+def token_size(token):
+    if token & 0x80:
+        return 2 if token & 0x40 else 1
+    return 1 + bin(token & 0x07).count('1') + 3 * bin(token & 0x18).count('1')
+
+
+def load(args):
+    import termios
+    with open(args.recording, 'rb') as f:
+        stream = f.read()
+    # Cut at a token boundary, like the adapter does when recording
+    cut = 0
+    while cut < len(stream) and cut + token_size(stream[cut]) <= args.size:
+        cut += token_size(stream[cut])
+    if cut < len(stream):
+        print('only the first %d of %d bytes fit in the EEPROM' % (cut, len(stream)), file=sys.stderr)
+
+    fd = os.open(args.port, os.O_RDWR | os.O_NOCTTY)
+    attrs = termios.tcgetattr(fd)
+    speed = getattr(termios, 'B%d' % args.baud)
+    attrs[0] = attrs[1] = attrs[3] = 0
+    attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+    attrs[4] = attrs[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+
+    os.write(fd, encode_frame(FRAME_CONFIG, [CONFIG_RECORD_MODE, MODE_LOADING]))
+    time.sleep(0.05)  # The old length is invalidated first
+    for i in range(0, cut, LOAD_CHUNK):
+        chunk = stream[i:min(i + LOAD_CHUNK, cut)]
+        os.write(fd, encode_frame(FRAME_RECORD_LOAD, chunk))
+        time.sleep(len(chunk) * EEPROM_BYTE_TIME)
+    os.write(fd, encode_frame(FRAME_CONFIG, [CONFIG_RECORD_MODE, MODE_IDLE]))
+    os.close(fd)
+    print('%d bytes loaded' % cut)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    commands = parser.add_subparsers(dest='command', required=True)
+    p = commands.add_parser('extract', help='collect a recording from a UART capture')
+    p.add_argument('capture')
+    p.add_argument('-o', '--output', required=True)
+    p.set_defaults(run=extract)
+    p = commands.add_parser('show', help='print the states of a recording')
+    p.add_argument('recording')
+    p.set_defaults(run=show)
+    p = commands.add_parser('load', help='store a recording in the adapter')
+    p.add_argument('recording')
+    p.add_argument('port')
+    p.add_argument('-b', '--baud', type=int, default=1000000)
+    p.add_argument('--size', type=int, default=EEPROM_SIZE, help='ADAPTER_RECORD_EEPROM_SIZE')
+    p.set_defaults(run=load)
+    args = parser.parse_args()
+    return args.run(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
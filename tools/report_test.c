@@ -0,0 +1,173 @@
+/*
+ * Wire bytes of the input reports for fixed inputs, run by "make -C tools test".
+ *
+ * Each report mode the console can select with SET_INPUT_REPORT_MODE (0x30 with and without IMU, 0x31, 0x3F) is
+ * checked byte for byte against a report written out by hand: buttons, hat, and both sticks at their extremes and
+ * centered. Only the timer byte isn't fixed, it is checked against get_report_counter().
+ */
+#include <string.h>
+
+#include "host.h"
+#include "Response.h"
+#include "test_console.h"
+
+static USB_ExtendedReport_t report;
+static USB_ExtendedReport_t *selectedReport = &report;
+static unsigned inputSteps = 0; // Calls of before_send(), one per report built
+
+static bool before_send(void) {
+    inputSteps++;
+    return true;
+}
+
+// No UART input in this test
+void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+}
+
+/*
+ * Set the 3 button bytes (REPORT_BUTTONS order) and both sticks (0-0xFFF, Y up as on the controller).
+ */
+static void set_input(uint8_t b0, uint8_t b1, uint8_t b2, uint16_t lx, uint16_t ly, uint16_t rx, uint16_t ry) {
+    uint8_t *input = REPORT_BUTTONS(&report.standardReport);
+    input[0] = b0;
+    input[1] = b1;
+    input[2] = b2;
+    const uint16_t axes[4] = {lx, ly, rx, ry};
+    for (uint8_t s = 0; s < 2; s++) {
+        uint8_t *analog = &input[REPORT_BUTTON_BYTES + 3 * s];
+        analog[0] = axes[2 * s] & 0xFF;
+        analog[1] = ((axes[2 * s + 1] & 0x0F) << 4) | (axes[2 * s] >> 8);
+        analog[2] = axes[2 * s + 1] >> 4;
+    }
+}
+
+static void set_mode(uint8_t mode) {
+    const uint8_t args[] = {mode};
+    CHECK(console_subcommand(SUBCOMMAND_SET_INPUT_REPORT_MODE, args, sizeof(args)) != NULL);
+    CHECK(get_console_state()->report_mode == mode);
+}
+
+static void set_imu(bool enable) {
+    const uint8_t args[] = {enable};
+    CHECK(console_subcommand(SUBCOMMAND_ENABLE_IMU, args, sizeof(args)) != NULL);
+}
+
+/*
+ * Poll one report and compare it with 'expected' (64 bytes, or 12 for 0x3F), whose timer byte is filled in here.
+ */
+static void check_report(uint8_t *expected, uint8_t length) {
+    const uint8_t *packet = console_poll();
+    expected[1] = get_report_counter();
+    CHECK(console_poll_length() == length);
+    CHECK_BYTES(packet, expected, length);
+}
+
+// B A, + HOME (and the grip bit), UP RIGHT ZL, left stick to the left and up, right stick to the right and down
+#define INPUT_EXTREMES 0x0C, 0x92, 0x86, 0x000, 0xFFF, 0xFFF, 0x000
+// Standard report bytes of INPUT_EXTREMES: connection info and battery, buttons, sticks, vibrator report
+#define STANDARD_EXTREMES 0x91, 0x0C, 0x92, 0x86, 0x00, 0xF0, 0xFF, 0xFF, 0x0F, 0x00, 0x0C
+
+static void test_standard(void) {
+    set_imu(false);
+    set_mode(0x30);
+    set_input(INPUT_EXTREMES);
+    uint8_t expected[JOYSTICK_EPSIZE] = {0x30, 0, STANDARD_EXTREMES};
+    check_report(expected, JOYSTICK_EPSIZE);
+}
+
+// With the IMU on, the 36 bytes of samples follow the standard report, little-endian
+static void test_standard_imu(void) {
+    set_imu(true);
+    set_input(INPUT_EXTREMES);
+    report.imu[0] = 0x1234;
+    report.imu[17] = -2;
+    uint8_t expected[JOYSTICK_EPSIZE] = {0x30, 0, STANDARD_EXTREMES, 0x34, 0x12};
+    expected[2 + sizeof(USB_StandardReport_t) + 34] = 0xFE;
+    expected[2 + sizeof(USB_StandardReport_t) + 35] = 0xFF;
+    check_report(expected, JOYSTICK_EPSIZE);
+    set_imu(false);
+    memset(report.imu, 0, sizeof(report.imu));
+}
+
+// 0x31 starts like 0x30 with the IMU on, the NFC/IR data stays zeroed
+static void test_nfc_ir(void) {
+    set_mode(0x31);
+    set_input(INPUT_EXTREMES);
+    report.imu[0] = 0x1234;
+    uint8_t expected[JOYSTICK_EPSIZE] = {0x31, 0, STANDARD_EXTREMES, 0x34, 0x12};
+    check_report(expected, JOYSTICK_EPSIZE);
+    memset(report.imu, 0, sizeof(report.imu));
+}
+
+static void test_simple(void) {
+    set_mode(0x3F);
+
+    // Sticks at the extremes: X scaled to 16 bit, Y flipped so it grows downwards
+    set_input(INPUT_EXTREMES);
+    uint8_t extremes[] = {0x3F, 0x43, 0x12, 0x01, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xFF, 0xF0, 0xFF};
+    CHECK_BYTES(console_poll(), extremes, sizeof(extremes));
+    CHECK(console_poll_length() == sizeof(extremes));
+    CHECK(console_poll() == NULL); // Unchanged, not sent again
+
+    // Every other button, SL/SR of either side, sticks centered
+    set_input(0xF3, 0x2D, 0x48, 0x800, 0x800, 0x800, 0x800);
+    uint8_t buttons[] = {0x3F, 0xBC, 0xED, 0x06, 0x00, 0x80, 0xF0, 0x7F, 0x00, 0x80, 0xF0, 0x7F};
+    CHECK_BYTES(console_poll(), buttons, sizeof(buttons));
+
+    // Nothing pressed
+    set_input(0x00, 0x00, 0x00, 0x800, 0x800, 0x800, 0x800);
+    uint8_t idle[] = {0x3F, 0x00, 0x00, 0x08, 0x00, 0x80, 0xF0, 0x7F, 0x00, 0x80, 0xF0, 0x7F};
+    CHECK_BYTES(console_poll(), idle, sizeof(idle));
+}
+
+// An unchanged 0x3F report leaves the endpoint free, the input still only steps once per poll interval
+static void test_simple_cadence(void) {
+    set_mode(0x3F);
+    set_input(0x00, 0x00, 0x00, 0x800, 0x800, 0x800, 0x800);
+    console_poll();
+    unsigned steps = inputSteps;
+    uint8_t counter = get_report_counter();
+    for (uint8_t i = 0; i < 10; i++) {
+        CHECK(send_IN_report() == 0); // Main loop passes within the same interval
+    }
+    CHECK(inputSteps == steps);
+    CHECK(get_report_counter() == counter);
+    CHECK(console_poll() == NULL);
+    CHECK(inputSteps == steps + 1);
+}
+
+// Hat values of the d-pad bits (DOWN UP RIGHT LEFT), opposite directions cancel
+static void test_hat(void) {
+    static const struct {
+        uint8_t dpad;
+        uint8_t hat;
+    } cases[] = {
+        {0x02, HAT_TOP}, {0x06, HAT_TOP_RIGHT}, {0x04, HAT_RIGHT}, {0x05, HAT_BOTTOM_RIGHT},
+        {0x01, HAT_BOTTOM}, {0x09, HAT_BOTTOM_LEFT}, {0x08, HAT_LEFT}, {0x0A, HAT_TOP_LEFT},
+        {0x03, HAT_CENTER}, {0x0C, HAT_CENTER}, {0x0F, HAT_CENTER}, {0x0E, HAT_TOP}, {0x07, HAT_RIGHT},
+    };
+    set_mode(0x3F);
+    for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        set_input(0x00, 0x00, cases[i].dpad, 0x800, 0x800, 0x800, 0x800);
+        const uint8_t *packet = console_poll();
+        CHECK(packet != NULL && packet[3] == cases[i].hat);
+        set_input(0x00, 0x00, 0x00, 0x000, 0x000, 0x000, 0x000); // Differs from every case, so the next one is sent
+        console_poll();
+    }
+}
+
+int main(void) {
+    report.standardReport.connection_info = 1;
+    report.standardReport.battery_level = BATTERY_FULL | BATTERY_CHARGING;
+    report.standardReport.vibrator_input_report = 0x0c;
+    setup_response_manager(before_send, &selectedReport);
+    console_handshake();
+
+    test_standard();
+    test_standard_imu();
+    test_nfc_ir();
+    test_simple();
+    test_hat();
+    test_simple_cadence();
+    return test_report("report_test");
+}
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+Generate SPIImage.h, the emulated SPI flash used by spi_read() in EmulatedSPI.c, from a Pro Controller flash dump.
+
+Usage: python3 tools/spi_image.py dump.bin [-o SPIImage.h]
+       python3 tools/spi_image.py --default [-o SPIImage.h]
+
+Only the regions the console reads are kept (REGIONS below). Regions that overlap or are separated by less than an
+index entry are merged, so the image is a few contiguous extents plus an index. Every byte not in the image reads
+as 0xFF, like erased flash. --default builds the image from the values the adapter shipped with instead of a dump.
+
+The flash footprint is printed, and the generated file is parsed back and checked against the dump byte for byte.
+Exits with 1 if the dump is too small or the check fails.
+"""
+import argparse
+import re
+import sys
+
+# https://github.com/dekuNukem/Nintendo_Switch_Reverse_Engineering/blob/master/spi_flash_notes.md
+REGIONS = [
+    ('serial number',             0x6000, 0x10),
+    ('factory IMU calibration',   0x6020, 0x18),
+    ('factory stick calibration', 0x603D, 0x12),
+    ('colors',                    0x6050, 0x0D),
+    ('factory parameters 1',      0x6080, 0x18),
+    ('factory parameters 2',      0x6098, 0x12),
+    ('user stick calibration',    0x8010, 0x18),
+    ('user IMU calibration',      0x8028, 0x18),
+]
+
+INDEX_ENTRY_SIZE = 5   # SPI_Region_t: address, length, offset
+MAX_EXTENT = 0xFF      # SPI_Region_t.length is one byte
+
+# Values the adapter shipped with before images were generated from dumps
+DEFAULT_CONTENTS = {
+    0x6020: 'e6 ff 3a 00 39 00 00 40 00 40 00 40 f7 ff fc ff 00 00 e7 3b e7 3b e7 3b',
+    0x603D: 'ba 15 62 11 b8 7f 29 06 5b ff e7 7e 0e 36 56 9e 85 60',
+    0x6080: '50 fd 00 00 c6 0f 0f 30 61 96 30 f3 d4 14 54 41 15 54 c7 79 9c 33 36 63',
+    0x6098: '0f 30 61 96 30 f3 d4 14 54 41 15 54 c7 79 9c 33 36 63',
+    0x8026: 'b2 a1',
+    0x8028: 'be ff 3e 00 f0 01 00 40 00 40 00 40 fe ff fe ff 08 00 e7 3b e7 3b e7 3b',
+}
+
+
+def default_dump():
+    dump = bytearray(b'\xff' * 0x80000)
+    for address, text in DEFAULT_CONTENTS.items():
+        data = bytes.fromhex(text)
+        dump[address:address + len(data)] = data
+    return bytes(dump)
+
+
+def extents():
+    """Merge REGIONS into (address, length) extents."""
+    merged = []
+    for _, address, length in sorted(REGIONS, key=lambda r: r[1]):
+        end = address + length
+        if merged and address - (merged[-1][0] + merged[-1][1]) < INDEX_ENTRY_SIZE and \
+                max(end, merged[-1][0] + merged[-1][1]) - merged[-1][0] <= MAX_EXTENT:
+            start = merged[-1][0]
+            merged[-1] = (start, max(end, start + merged[-1][1]) - start)
+        else:
+            merged.append((address, length))
+    return merged
+
+
+def render(dump, source):
+    lines = [
+        '// Generated by tools/spi_image.py from %s, do not edit' % source,
+        '#ifndef SPI_IMAGE_H',
+        '#define SPI_IMAGE_H',
+        '',
+        '#define SPI_IMAGE_REGIONS %d' % len(extents()),
+        '',
+        'static const uint8_t spi_image_data[] PROGMEM = {',
+    ]
+    index = []
+    offset = 0
+    for address, length in extents():
+        data = dump[address:address + length]
+        lines.append('    // 0x%04X' % address)
+        for i in range(0, length, 12):
+            lines.append('    ' + ' '.join('0x%02X,' % b for b in data[i:i + 12]))
+        index.append('    {0x%04X, %d, %d},' % (address, length, offset))
+        offset += length
+    lines += [
+        '};',
+        '',
+        'static const SPI_Region_t spi_image_index[SPI_IMAGE_REGIONS] PROGMEM = {',
+    ] + index + [
+        '};',
+        '',
+        '#endif // SPI_IMAGE_H',
+        '',
+    ]
+    return '\n'.join(lines), offset
+
+
+def read_back(text):
+    """Rebuild the flash contents the firmware will see from the generated file."""
+    data_text = re.search(r'spi_image_data\[\] PROGMEM = \{(.*?)\};', text, re.S).group(1)
+    data = [int(v, 16) for v in re.findall(r'0x([0-9A-F]{2}),', data_text)]
+    index_text = re.search(r'spi_image_index\[SPI_IMAGE_REGIONS\] PROGMEM = \{(.*?)\};', text, re.S).group(1)
+    flash = {}
+    for address, length, offset in re.findall(r'\{0x([0-9A-F]+), (\d+), (\d+)\}', index_text):
+        address, length, offset = int(address, 16), int(length), int(offset)
+        for i in range(length):
+            flash[address + i] = data[offset + i]
+    return flash
+
+
+def verify(text, dump):
+    flash = read_back(text)
+    errors = 0
+    for address, length in extents():
+        for a in range(address, address + length):
+            if flash.get(a, 0xFF) != dump[a]:
+                print('0x%04X is 0x%02X, dump has 0x%02X' % (a, flash.get(a, 0xFF), dump[a]), file=sys.stderr)
+                errors += 1
+    for name, address, length in REGIONS:
+        if any(a not in flash for a in range(address, address + length)):
+            print('%s is not fully in the image' % name, file=sys.stderr)
+            errors += 1
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('dump', nargs='?', help='SPI flash dump (512 KB)')
+    parser.add_argument('--default', action='store_true', help='use the built-in default contents')
+    parser.add_argument('-o', '--output', default='SPIImage.h')
+    args = parser.parse_args()
+
+    if args.default:
+        dump, source = default_dump(), 'the built-in defaults'
+    elif args.dump:
+        with open(args.dump, 'rb') as f:
+            dump = f.read()
+        source = args.dump.replace('\\', '/').split('/')[-1]
+    else:
+        parser.error('a dump or --default is required')
+
+    end = max(address + length for _, address, length in REGIONS)
+    if len(dump) < end:
+        print('dump is %d bytes, needs at least 0x%X' % (len(dump), end), file=sys.stderr)
+        return 1
+
+    text, data_size = render(dump, source)
+    errors = verify(text, dump)
+    if errors:
+        print('%d bytes differ, %s not written' % (errors, args.output), file=sys.stderr)
+        return 1
+    with open(args.output, 'w') as f:
+        f.write(text)
+
+    index_size = len(extents()) * INDEX_ENTRY_SIZE
+    print('%s: %d regions in %d extents, %d bytes data + %d bytes index = %d bytes flash' %
+          (args.output, len(REGIONS), len(extents()), data_size, index_size, data_size + index_size))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
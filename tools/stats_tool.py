@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+Read the statistics of a running adapter over its UART (HOSTLINK_STATS_REQUEST, see HostLink.h).
+
+Usage: python3 tools/stats_tool.py /dev/ttyUSB0 [-b 1000000] [-c controller] [name ...]
+
+Names: subcommands, pacing, latch, stream, in_latency, interface. Without names every kind of stats is read. Stats
+the adapter was built without are reported as not available. Per-controller stats are read for the controller given
+with -c (1 is the second one of an ADAPTER_DUAL build).
+"""
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+
+SYNC = 0xA5
+FRAME_STATS_REQUEST = 0x09
+FRAME_STATS = 0x23
+TIMEOUT = 1.0
+TICK_US = 16  # Clock.h, F_CPU / 256 at 16 MHz
+
+DATATYPES_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'datatypes.h')
+
+
+def encode_frame(frame_type, payload):
+    checksum = frame_type ^ len(payload)
+    for b in payload:
+        checksum ^= b
+    return bytes([SYNC, frame_type, len(payload)]) + bytes(payload) + bytes([checksum])
+
+
+def u16(data, offset):
+    return data[offset] | (data[offset + 1] << 8)
+
+
+def subcommand_names():
+    """Map subcommand ids to their Switch_Subcommand_t names."""
+    with open(DATATYPES_H) as f:
+        text = f.read()
+    body = re.search(r'typedef enum \{(.*?)\} Switch_Subcommand_t;', text, re.S).group(1)
+    return {int(value, 0): name[len('SUBCOMMAND_'):].lower()
+            for name, value in re.findall(r'(SUBCOMMAND_\w+)\s*=\s*(0x[0-9A-Fa-f]+)', body)}
+
+
+class Port:
+    def __init__(self, path, baud):
+        import termios
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        attrs = termios.tcgetattr(self.fd)
+        speed = getattr(termios, 'B%d' % baud)
+        attrs[0] = attrs[1] = attrs[3] = 0
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.buffer = bytearray()
+
+    def request(self, stats_id, argument=0):
+        """Return the stats bytes of the reply, None if the adapter doesn't have them."""
+        os.write(self.fd, encode_frame(FRAME_STATS_REQUEST, [stats_id, argument]))
+        deadline = time.monotonic() + TIMEOUT
+        while time.monotonic() < deadline:
+            try:
+                self.buffer += os.read(self.fd, 256)
+            except BlockingIOError:
+                time.sleep(0.005)
+            for frame_type, payload in self.frames():
+                if frame_type == FRAME_STATS and payload[:2] == bytes([stats_id, argument]):
+                    return payload[2:] or None
+        raise TimeoutError('no reply to stats request 0x%02x' % stats_id)
+
+    def frames(self):
+        """Yield (type, payload) for the complete frames in the buffer (other frames are skipped too)."""
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                self.buffer.clear()
+                return
+            del self.buffer[:start]
+            if len(self.buffer) < 3 or len(self.buffer) < self.buffer[2] + 4:
+                return
+            length = self.buffer[2]
+            checksum = 0
+            for b in self.buffer[1:3 + length]:
+                checksum ^= b
+            if checksum != self.buffer[3 + length]:
+                del self.buffer[0]
+                continue
+            frame = (self.buffer[1], bytes(self.buffer[3:3 + length]))
+            del self.buffer[:length + 4]
+            yield frame
+
+
+def show_subcommands(port, controller):
+    names = subcommand_names()
+    total = 0
+    for first in range(0, max(names) + 1, 8):
+        data = port.request(0x01, first)
+        if data is None:
+            print('subcommands: not available (ADAPTER_SUBCOMMAND_STATS)')
+            return
+        for i in range(8):
+            hits = u16(data, 2 * i)
+            if hits:
+                total += hits
+                print('  0x%02x %-28s %u' % (first + i, names.get(first + i, '?'), hits))
+    print('subcommands: %u in total' % total)
+
+
+def show_struct(port, title, stats_id, fields, argument=0, option=None):
+    """Print a stats struct. fields: (name, struct format, unit), unit 'ticks' values are shown in milliseconds."""
+    data = port.request(stats_id, argument)
+    if data is None:
+        print('%s: not available%s' % (title, ' (%s)' % option if option else ''))
+        return
+    values = struct.unpack('<' + ''.join(f for _, f, _ in fields), data)
+    text = []
+    for (name, _, unit), value in zip(fields, values):
+        text.append('%s %.3f ms' % (name, value * TICK_US / 1000.0) if unit == 'ticks' else '%s %u' % (name, value))
+    print('%s: %s' % (title, ', '.join(text)))
+
+
+def show_pacing(port, controller):
+    show_struct(port, 'pacing', 0x02, [('reports', 'H', None), ('missed', 'H', None), ('late max', 'H', 'ticks'),
+                                       ('late total', 'I', 'ticks')], controller, 'ADAPTER_REPORT_PACING_MS')
+
+
+def show_latch(port, controller):
+    show_struct(port, 'latch', 0x03, [('taps saved', 'H', None), ('queue full', 'H', None),
+                                      ('latency max', 'H', 'ticks')])
+
+
+def show_stream(port, controller):
+    show_struct(port, 'stream', 0x04, [('stalls', 'H', None), ('resyncs', 'H', None)])
+
+
+def show_in_latency(port, controller):
+    show_struct(port, 'in latency', 0x05, [('samples', 'H', None), ('max', 'H', 'ticks'), ('total', 'I', 'ticks')],
+                controller)
+
+
+def show_interface(port, controller):
+    show_struct(port, 'interface', 0x06, [('in packets', 'I', None), ('in bytes', 'I', None),
+                                          ('out packets', 'I', None), ('out bytes', 'I', None)], controller)
+
+
+STATS = {
+    'subcommands': show_subcommands,
+    'pacing': show_pacing,
+    'latch': show_latch,
+    'stream': show_stream,
+    'in_latency': show_in_latency,
+    'interface': show_interface,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('port')
+    parser.add_argument('-b', '--baud', type=int, default=1000000)
+    parser.add_argument('-c', '--controller', type=int, default=0, help='controller of per-controller stats')
+    parser.add_argument('names', nargs='*', help='stats to read: %s (default: all)' % ', '.join(STATS))
+    args = parser.parse_intermixed_args()
+    for name in args.names:
+        if name not in STATS:
+            parser.error('unknown stats %s' % name)
+
+    port = Port(args.port, args.baud)
+    for name in args.names or STATS:
+        STATS[name](port, args.controller)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
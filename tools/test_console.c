@@ -0,0 +1,95 @@
+#include "test_console.h"
+
+#include <string.h>
+
+#include "host.h"
+#include "Response.h"
+
+#define POLL_TICKS CLOCK_US_TO_TICKS(8000UL)
+
+unsigned test_failures = 0;
+
+static uint32_t now = 0;
+static uint8_t packetCounter = 0;
+static uint8_t packet[HOST_PACKET_SIZE];
+static uint8_t packetLength = 0;
+
+int test_bytes_equal(const char *file, int line, const uint8_t *actual, const uint8_t *expected, unsigned length) {
+    if (actual != NULL && memcmp(actual, expected, length) == 0) {
+        return 1;
+    }
+    printf("%s:%d: bytes differ\n  expected", file, line);
+    for (unsigned i = 0; i < length; i++) {
+        printf(" %02x", expected[i]);
+    }
+    printf("\n  actual  ");
+    for (unsigned i = 0; actual != NULL && i < length; i++) {
+        printf(" %02x", actual[i]);
+    }
+    printf("%s\n", actual == NULL ? " (nothing sent)" : "");
+    return 0;
+}
+
+int test_report(const char *name) {
+    if (test_failures != 0) {
+        printf("%s: %u checks failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+void console_out(const uint8_t *data, uint8_t length) {
+    uint8_t buffer[JOYSTICK_EPSIZE];
+    memcpy(buffer, data, length);
+    process_OUT_report(buffer, length);
+}
+
+/*
+ * host.c keeps the bytes of longer earlier packets after a short one, the copy here is zero-filled past its length.
+ */
+const uint8_t *console_poll(void) {
+    now += POLL_TICKS;
+    host_clock_set(now);
+    memset(packet, 0, sizeof(packet));
+    packetLength = 0;
+    if (send_IN_report() == 0) {
+        return NULL;
+    }
+    packetLength = host_in_length;
+    memcpy(packet, host_in_packet, host_in_length);
+    return packet;
+}
+
+uint8_t console_poll_length(void) {
+    return packetLength;
+}
+
+const uint8_t *console_command(uint8_t command) {
+    const uint8_t out[] = {0x80, command};
+    console_out(out, sizeof(out));
+    return console_poll();
+}
+
+const uint8_t *console_subcommand(uint8_t subcommand, const uint8_t *args, uint8_t length) {
+    uint8_t out[JOYSTICK_EPSIZE] = {0x01, packetCounter++ & 0x0F};
+    out[10] = subcommand;
+    memcpy(&out[11], args, length);
+    console_out(out, sizeof(out));
+    // An input report may already be waiting for the endpoint, the reply comes after it
+    for (uint8_t i = 0; i < 3; i++) {
+        const uint8_t *reply = console_poll();
+        if (reply != NULL && reply[0] == 0x21) {
+            return reply;
+        }
+    }
+    return NULL;
+}
+
+void console_handshake(void) {
+    console_command(0x01);
+    console_command(0x02);
+    console_command(0x03);
+    console_command(0x02);
+    console_command(0x04);
+}
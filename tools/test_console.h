@@ -0,0 +1,52 @@
+/*
+ * Console side of the USB protocol for the host tests ("make -C tools test").
+ *
+ * Drives the host build of Response.c the way the Switch does: OUT packets go to process_OUT_report(), and every
+ * poll calls send_IN_report() with the clock moved on by one 8 ms USB interval. Replies are read from the packet
+ * host.c captured, so they are the exact bytes the console would get.
+ */
+#ifndef TOOLS_TEST_CONSOLE_H
+#define TOOLS_TEST_CONSOLE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern unsigned test_failures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++; \
+        } \
+    } while (0)
+
+// Compare 'length' bytes, printing both packets on a mismatch
+#define CHECK_BYTES(actual, expected, length) \
+    CHECK(test_bytes_equal(__FILE__, __LINE__, (actual), (expected), (length)))
+
+int test_bytes_equal(const char *file, int line, const uint8_t *actual, const uint8_t *expected, unsigned length);
+// Print the result and return the exit status for main()
+int test_report(const char *name);
+
+// Send an OUT packet (no poll)
+void console_out(const uint8_t *packet, uint8_t length);
+// Poll the IN endpoint once. Returns the packet, or NULL if the firmware had nothing to send.
+const uint8_t *console_poll(void);
+uint8_t console_poll_length(void); // Length of the packet returned by the last console_poll()
+// 0x80 command, returns the reply (NULL if none)
+const uint8_t *console_command(uint8_t command);
+// 0x01 subcommand, returns the 0x21 reply (NULL if none)
+const uint8_t *console_subcommand(uint8_t subcommand, const uint8_t *args, uint8_t length);
+// USB handshake up to 80 04, after which input reports start
+void console_handshake(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TOOLS_TEST_CONSOLE_H
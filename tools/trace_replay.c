@@ -0,0 +1,257 @@
+/*
+ * Replay a USB trace captured with ADAPTER_TRACE against the host build of the firmware.
+ *
+ * The trace file is the raw byte stream read from the adapter's UART (other HostLink frames and line noise are
+ * skipped). Every OUT packet is fed to process_OUT_report() and every recorded IN packet is compared with what
+ * send_IN_report() produces at the same point. The clock follows the recorded timestamps instead of wall time,
+ * so replays run as fast as the CPU allows. Traces of an ADAPTER_DUAL adapter interleave both controllers' packets;
+ * built with -DADAPTER_DUAL (make trace_replay_dual) each one is replayed against its own protocol state, otherwise
+ * the second controller's records are skipped.
+ *
+ * Usage: trace_replay [-s] [-v] trace.bin
+ *   -s  strict: also compare the timer byte, the controller state and input bytes, and expect every 0x3F report
+ *   -v  print every mismatching packet
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "host.h"
+#include "Response.h"
+
+#define STANDARD_REPORT_END (2 + sizeof(USB_StandardReport_t))
+
+typedef struct {
+    uint32_t records;
+    uint32_t out;
+    uint32_t in;
+    uint32_t mismatched;
+    uint32_t missing;
+    uint32_t gaps;
+    uint32_t bad_frames;
+    uint32_t skipped; // Second controller's records, without ADAPTER_DUAL
+} Replay_Stats_t;
+
+static USB_ExtendedReport_t idleReport;
+static USB_ExtendedReport_t *selectedReport = &idleReport;
+static bool strict = false;
+static bool verbose = false;
+
+static bool before_send(void) {
+    return true;
+}
+
+// UART input isn't part of the trace
+void CALLBACK_HostLink_Frame(uint8_t type, const uint8_t *payload, uint8_t length) {
+}
+
+static void initialize_idle_report(USB_ExtendedReport_t *extendedReport) {
+    memset(extendedReport, 0, sizeof(USB_ExtendedReport_t));
+    USB_StandardReport_t *standardReport = &(extendedReport->standardReport);
+    standardReport->connection_info = 1;
+    standardReport->battery_level = BATTERY_FULL | BATTERY_CHARGING;
+    standardReport->charging_grip = true;
+    const uint8_t centered[] = {0x00, 0x08, 0x80, 0x00, 0x08, 0x80};
+    memcpy(standardReport->analog, centered, sizeof(centered));
+    standardReport->vibrator_input_report = 0x0c;
+}
+
+// Returns the unpacked length, or -1 if the data is malformed
+static int unpackbits(const uint8_t *src, size_t length, uint8_t *dst) {
+    size_t in = 0;
+    int out = 0;
+    while (in < length) {
+        uint8_t control = src[in++];
+        if (control < 0x80) {
+            size_t n = control + 1;
+            if (in + n > length || out + n > HOST_PACKET_SIZE) return -1;
+            memcpy(&dst[out], &src[in], n);
+            in += n;
+            out += n;
+        } else if (control > 0x80) {
+            size_t n = 257 - control;
+            if (in >= length || out + n > HOST_PACKET_SIZE) return -1;
+            memset(&dst[out], src[in++], n);
+            out += n;
+        } else {
+            return -1;
+        }
+    }
+    return out;
+}
+
+// Bytes that depend on timing or on UART input (neither is in the trace) are ignored unless strict. Only the recorded
+// length is compared, 0x3F reports are shorter than the endpoint.
+static bool packet_matches(const uint8_t *expected, int expectedLength, const uint8_t *actual, int actualLength) {
+    if (expectedLength != actualLength) return false;
+    for (int i = 0; i < expectedLength; i++) {
+        if (!strict && i >= 1) {
+            if (expected[0] == 0x3F) continue; // Buttons, hat and sticks
+            if (expected[0] == 0x30 || expected[0] == 0x31) continue; // Timer, state, then IMU or NFC/IR data
+            if (expected[0] == 0x21 && i < STANDARD_REPORT_END) continue; // Timer and state
+        }
+        if (expected[i] != actual[i]) return false;
+    }
+    return true;
+}
+
+static void print_packet(const char *label, const uint8_t *packet, int length) {
+    printf("  %s", label);
+    for (int i = 0; i < length; i++) {
+        printf(" %02x", packet[i]);
+    }
+    printf("\n");
+}
+
+static void replay_record(const uint8_t *payload, size_t length, uint32_t *stamp, Replay_Stats_t *stats) {
+    uint8_t flags = payload[0];
+    size_t n = 1;
+    uint32_t delta = 0;
+    for (uint8_t shift = 0; n < length && shift < 35; shift += 7) {
+        uint8_t b = payload[n++];
+        delta |= (uint32_t) (b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+
+    uint8_t packet[HOST_PACKET_SIZE] = {0};
+    int packetLength = unpackbits(&payload[n], length - n, packet);
+    if (packetLength < 0) {
+        stats->bad_frames++;
+        return;
+    }
+
+    *stamp += delta;
+    host_clock_set(*stamp);
+    stats->records++;
+#ifdef ADAPTER_DUAL
+    response_select(flags & TRACE_FLAG_PLAYER_2 ? 1 : 0);
+#else
+    if (flags & TRACE_FLAG_PLAYER_2) {
+        stats->skipped++;
+        return;
+    }
+#endif
+    if (flags & TRACE_FLAG_DROPPED) {
+        stats->gaps++;
+    }
+
+    if (!(flags & TRACE_FLAG_IN)) {
+        stats->out++;
+        process_OUT_report(packet, packetLength);
+        return;
+    }
+
+    stats->in++;
+    uint32_t before = host_in_count;
+    send_IN_report();
+    if (host_in_count == before) {
+        if (!strict && packet[0] == 0x3F) {
+            return; // Sent when the inputs changed, which the replay can't reproduce
+        }
+        stats->missing++;
+        if (verbose) {
+            printf("record %u (t=%u): no reply\n", stats->records, *stamp);
+            print_packet("expected", packet, packetLength);
+        }
+    } else if (!packet_matches(packet, packetLength, host_in_packet, host_in_length)) {
+        stats->mismatched++;
+        if (verbose) {
+            printf("record %u (t=%u): mismatch\n", stats->records, *stamp);
+            print_packet("expected", packet, packetLength);
+            print_packet("actual  ", host_in_packet, host_in_length);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "sv")) != -1) {
+        switch (opt) {
+            case 's': strict = true; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-s] [-v] trace.bin\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-s] [-v] trace.bin\n", argv[0]);
+        return 2;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(argv[optind]);
+        return 2;
+    }
+    if (st.st_size == 0) {
+        fprintf(stderr, "%s: empty trace\n", argv[optind]);
+        return 2;
+    }
+    const uint8_t *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return 2;
+    }
+    madvise((void *) data, st.st_size, MADV_SEQUENTIAL);
+
+    initialize_idle_report(&idleReport);
+    for (uint8_t player = JOYSTICK_COUNT; player-- > 0;) {
+        response_select(player);
+        setup_response_manager(before_send, &selectedReport);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    Replay_Stats_t stats = {0};
+    uint32_t stamp = 0;
+    size_t size = st.st_size;
+    size_t i = 0;
+    while (i + HOSTLINK_FRAME_OVERHEAD <= size) {
+        if (data[i] != HOSTLINK_SYNC) {
+            i++;
+            continue;
+        }
+        uint8_t type = data[i + 1];
+        uint8_t length = data[i + 2];
+        if (i + HOSTLINK_FRAME_OVERHEAD + length > size) break;
+
+        const uint8_t *payload = &data[i + 3];
+        uint8_t checksum = type ^ length;
+        for (uint8_t k = 0; k < length; k++) {
+            checksum ^= payload[k];
+        }
+        if (checksum != payload[length]) {
+            stats.bad_frames++;
+            i++; // Resynchronize on the next sync byte
+            continue;
+        }
+        if (type == HOSTLINK_TRACE && length > 0) {
+            replay_record(payload, length, &stamp, &stats);
+        }
+        i += HOSTLINK_FRAME_OVERHEAD + length;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double traced = stamp * (CLOCK_PRESCALER / (double) F_CPU);
+
+    printf("records %u (OUT %u, IN %u), gaps %u, bad frames %u\n",
+           stats.records, stats.out, stats.in, stats.gaps, stats.bad_frames);
+    printf("IN mismatched %u, missing %u\n", stats.mismatched, stats.missing);
+    if (stats.skipped) {
+        printf("skipped %u records of the second controller, replay them with trace_replay_dual\n", stats.skipped);
+    }
+    printf("traced %.1f s, replayed in %.3f s (%.0fx real time)\n", traced, wall, wall > 0 ? traced / wall : 0);
+
+    munmap((void *) data, st.st_size);
+    close(fd);
+    return (stats.mismatched || stats.missing) ? 1 : 0;
+}